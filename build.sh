@@ -10,5 +10,17 @@ BUILD_DIR=./build
 # cc -Wall -o $BUILD_DIR/gate_test ./tests/test_gate.c -lm
 # cc -Wall -o $BUILD_DIR/fullnn_test ./src/main.c ./src/nn.c -lm
 
-# cc -Wall -Wpedantic -ggdb -fanalyzer -fsanitize=address -o $BUILD_DIR/perceptron -I./src/ ./src/random.c ./tests/perceptron.c -lm
-cc -Wall -Wpedantic -ggdb -fanalyzer -fsanitize=address -o $BUILD_DIR/network -I./src/ ./src/random.c ./tests/network.c -lm
+CFLAGS="-Wall -Wpedantic -O2 -ggdb -fanalyzer -fsanitize=address"
+
+# cc $CFLAGS -o $BUILD_DIR/perceptron -I./src/ ./src/random.c ./tests/perceptron.c -lm
+cc $CFLAGS -o $BUILD_DIR/network -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/plan.c ./src/memplan.c ./tests/network.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/matrix -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./tests/matrix.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/activation -I./src/ ./src/random.c ./src/simd.c ./src/activation.c ./tests/activation.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/train -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/plan.c ./src/memplan.c ./tests/train.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/model -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/plan.c ./src/memplan.c ./tests/model.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/serve -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/plan.c ./src/memplan.c ./src/serve.c ./tests/serve.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/nn-serve -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/plan.c ./src/memplan.c ./src/serve.c ./tools/nn_serve.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/handle -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/plan.c ./src/memplan.c ./src/handle.c ./tests/handle.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/inference -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/plan.c ./src/memplan.c ./tests/inference.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/dataset -I./src/ ./src/random.c ./src/simd.c ./src/gemm.c ./src/activation.c ./src/threadpool.c ./src/network.c ./src/netfile.c ./src/memplan.c ./src/dataset.c ./tests/dataset.c -lm -lpthread
+cc $CFLAGS -o $BUILD_DIR/arena -I./src/ ./tests/arena.c -lm -lpthread
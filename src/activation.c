@@ -0,0 +1,635 @@
+#include "activation.h"
+#include "simd.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(ARCH_X64) || defined(ARCH_X86)
+# include <immintrin.h>
+# define ACTIVATION_X86 1
+#endif
+
+// NOTE(liam): exp(x) = 2^n * exp(r), n = round(x / ln2), |r| <= ln2 / 2.
+// ln2 is split in two so r keeps its low bits (cephes expf). the input is
+// clamped so 2^n stays a normal float.
+#define ACT_EXP_HI   88.3762626647949f
+#define ACT_EXP_LO  -87.3365447504f
+#define ACT_LOG2E    1.44269504088896341f
+#define ACT_LN2_HI   0.693359375f
+#define ACT_LN2_LO  -2.12194440e-4f
+
+// NOTE(liam): cephes degree-6 minimax polynomial for exp(r) on the reduced
+// range (~1 ulp), and a plain degree-4 taylor one for fast mode (~3e-5 rel).
+#define ACT_EXP_P0   1.9875691500e-4f
+#define ACT_EXP_P1   1.3981999507e-3f
+#define ACT_EXP_P2   8.3334519073e-3f
+#define ACT_EXP_P3   4.1665795894e-2f
+#define ACT_EXP_P4   1.6666665459e-1f
+#define ACT_EXP_P5   5.0000001201e-1f
+#define ACT_EXP_F0   4.1666666667e-2f
+#define ACT_EXP_F1   1.6666666667e-1f
+
+// NOTE(liam): abramowitz & stegun 7.1.26, |erf error| <= 1.5e-7 for t >= 0.
+#define ACT_ERF_P    0.3275911f
+#define ACT_ERF_A1   0.254829592f
+#define ACT_ERF_A2  -0.284496736f
+#define ACT_ERF_A3   1.421413741f
+#define ACT_ERF_A4  -1.453152027f
+#define ACT_ERF_A5   1.061405429f
+
+#define ACT_SQRT1_2      0.70710678118654752f
+#define ACT_SQRT2_PI     0.79788456080286536f
+#define ACT_GELU_CUBIC   0.044715f
+
+////////////////////////////////
+// NOTE(liam): exact, through libm.
+
+static void
+ActSigmoidExact(float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = 1.f / (1.f + expf(-x[i]));
+}
+
+static void
+ActTanhExact(float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = tanhf(x[i]);
+}
+
+static void
+ActGeluExact(float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = 0.5f * x[i] * (1.f + erff(x[i] * ACT_SQRT1_2));
+}
+
+static void
+ActExpExact(float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = expf(x[i]);
+}
+
+////////////////////////////////
+// NOTE(liam): portable polynomial versions. these run on scalar/sse4 and
+// handle the tails of the avx2 kernels, so every level agrees bit-for-bit
+// up to fma contraction.
+
+static inline float32
+ActExpScalar(float32 x, bool32 fast)
+{
+    x = Min(Max(x, ACT_EXP_LO), ACT_EXP_HI);
+    float32 t = x * ACT_LOG2E;
+    int32 ni = (int32)(t + (t >= 0.f ? 0.5f : -0.5f));
+    float32 fn = (float32)ni;
+    float32 r = x - fn * ACT_LN2_HI;
+    r = r - fn * ACT_LN2_LO;
+
+    float32 p;
+    if (fast)
+    {
+        p = ACT_EXP_F0;
+        p = p * r + ACT_EXP_F1;
+        p = p * r + 0.5f;
+    }
+    else
+    {
+        p = ACT_EXP_P0;
+        p = p * r + ACT_EXP_P1;
+        p = p * r + ACT_EXP_P2;
+        p = p * r + ACT_EXP_P3;
+        p = p * r + ACT_EXP_P4;
+        p = p * r + ACT_EXP_P5;
+    }
+    p = p * (r * r) + r + 1.f;
+
+    uint32 bits = (uint32)(ni + 127) << 23;
+    float32 scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+static inline float32
+ActSigmoidScalar(float32 x, bool32 fast)
+{
+    return 1.f / (1.f + ActExpScalar(-x, fast));
+}
+
+// NOTE(liam): tanh(x) = sign(x) * (1 - e) / (1 + e), e = exp(-2|x|). unlike
+// 2*sigmoid(2x) - 1 this keeps its absolute error near zero.
+static inline float32
+ActTanhScalar(float32 x, bool32 fast)
+{
+    float32 e = ActExpScalar(-2.f * fabsf(x), fast);
+    return copysignf((1.f - e) / (1.f + e), x);
+}
+
+// NOTE(liam): approx is x * Phi(x) with the A&S erf; fast is the usual
+// tanh form, rewritten as x * sigmoid(2u).
+static inline float32
+ActGeluScalar(float32 x, bool32 fast)
+{
+    if (fast)
+    {
+        float32 u = ACT_SQRT2_PI * (x + ACT_GELU_CUBIC * x * x * x);
+        return x / (1.f + ActExpScalar(-2.f * u, true));
+    }
+
+    float32 t = fabsf(x) * ACT_SQRT1_2;
+    float32 k = 1.f / (1.f + ACT_ERF_P * t);
+    float32 p = ACT_ERF_A5;
+    p = p * k + ACT_ERF_A4;
+    p = p * k + ACT_ERF_A3;
+    p = p * k + ACT_ERF_A2;
+    p = p * k + ACT_ERF_A1;
+    p = p * k;
+    float32 erf = copysignf(1.f - p * ActExpScalar(-t * t, false), x);
+    return 0.5f * x * (1.f + erf);
+}
+
+#define ACT_DEFINE_SCALAR_ROW(NAME, FN, FAST) \
+    static void \
+    NAME(float32 *x, size_t n) \
+    { \
+        for (size_t i = 0; i < n; i++) x[i] = FN(x[i], FAST); \
+    }
+
+ACT_DEFINE_SCALAR_ROW(ActExpApproxScalar, ActExpScalar, false)
+ACT_DEFINE_SCALAR_ROW(ActExpFastScalar, ActExpScalar, true)
+ACT_DEFINE_SCALAR_ROW(ActSigmoidApproxScalar, ActSigmoidScalar, false)
+ACT_DEFINE_SCALAR_ROW(ActSigmoidFastScalar, ActSigmoidScalar, true)
+ACT_DEFINE_SCALAR_ROW(ActTanhApproxScalar, ActTanhScalar, false)
+ACT_DEFINE_SCALAR_ROW(ActTanhFastScalar, ActTanhScalar, true)
+ACT_DEFINE_SCALAR_ROW(ActGeluApproxScalar, ActGeluScalar, false)
+ACT_DEFINE_SCALAR_ROW(ActGeluFastScalar, ActGeluScalar, true)
+
+static void
+ActReluScalar(float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = x[i] > 0.f ? x[i] : 0.f;
+}
+
+static void
+ActLeakyReluScalar(float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] = x[i] > 0.f ? x[i] : ACTIVATION_LEAKY_SLOPE * x[i];
+}
+
+////////////////////////////////
+// NOTE(liam): avx2 + fma, 8 lanes. tails go through the scalar polynomial.
+
+#ifdef ACTIVATION_X86
+__attribute__((target("avx2,fma"))) static inline __m256
+ActExpAVX2(__m256 x, bool32 fast)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(ACT_EXP_LO)), _mm256_set1_ps(ACT_EXP_HI));
+    __m256 fn = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(ACT_LOG2E)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(ACT_LN2_HI), x);
+    r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(ACT_LN2_LO), r);
+
+    __m256 p;
+    if (fast)
+    {
+        p = _mm256_set1_ps(ACT_EXP_F0);
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(ACT_EXP_F1));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(0.5f));
+    }
+    else
+    {
+        p = _mm256_set1_ps(ACT_EXP_P0);
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(ACT_EXP_P1));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(ACT_EXP_P2));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(ACT_EXP_P3));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(ACT_EXP_P4));
+        p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(ACT_EXP_P5));
+    }
+    p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.f)));
+
+    __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(fn), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256
+ActSigmoidAVX2(__m256 x, bool32 fast)
+{
+    __m256 one = _mm256_set1_ps(1.f);
+    __m256 e = ActExpAVX2(_mm256_sub_ps(_mm256_setzero_ps(), x), fast);
+    return _mm256_div_ps(one, _mm256_add_ps(one, e));
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256
+ActTanhAVX2(__m256 x, bool32 fast)
+{
+    __m256 one = _mm256_set1_ps(1.f);
+    __m256 sign = _mm256_and_ps(x, _mm256_set1_ps(-0.f));
+    __m256 ax = _mm256_andnot_ps(_mm256_set1_ps(-0.f), x);
+    __m256 e = ActExpAVX2(_mm256_mul_ps(ax, _mm256_set1_ps(-2.f)), fast);
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(one, e), _mm256_add_ps(one, e));
+    return _mm256_or_ps(t, sign);
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256
+ActGeluAVX2(__m256 x, bool32 fast)
+{
+    __m256 one = _mm256_set1_ps(1.f);
+    if (fast)
+    {
+        __m256 x3 = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+        __m256 u = _mm256_mul_ps(_mm256_set1_ps(ACT_SQRT2_PI),
+                                 _mm256_fmadd_ps(x3, _mm256_set1_ps(ACT_GELU_CUBIC), x));
+        __m256 e = ActExpAVX2(_mm256_mul_ps(u, _mm256_set1_ps(-2.f)), true);
+        return _mm256_div_ps(x, _mm256_add_ps(one, e));
+    }
+
+    __m256 sign = _mm256_and_ps(x, _mm256_set1_ps(-0.f));
+    __m256 t = _mm256_mul_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.f), x), _mm256_set1_ps(ACT_SQRT1_2));
+    __m256 k = _mm256_div_ps(one, _mm256_fmadd_ps(t, _mm256_set1_ps(ACT_ERF_P), one));
+    __m256 p = _mm256_set1_ps(ACT_ERF_A5);
+    p = _mm256_fmadd_ps(p, k, _mm256_set1_ps(ACT_ERF_A4));
+    p = _mm256_fmadd_ps(p, k, _mm256_set1_ps(ACT_ERF_A3));
+    p = _mm256_fmadd_ps(p, k, _mm256_set1_ps(ACT_ERF_A2));
+    p = _mm256_fmadd_ps(p, k, _mm256_set1_ps(ACT_ERF_A1));
+    p = _mm256_mul_ps(p, k);
+    __m256 e = ActExpAVX2(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(t, t)), false);
+    __m256 erf = _mm256_or_ps(_mm256_fnmadd_ps(p, e, one), sign);
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), x), _mm256_add_ps(one, erf));
+}
+
+#define ACT_DEFINE_AVX2_ROW(NAME, FN, SCALAR, FAST) \
+    __attribute__((target("avx2,fma"))) static void \
+    NAME(float32 *x, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 8 <= n; i += 8) \
+        { \
+            _mm256_storeu_ps(x + i, FN(_mm256_loadu_ps(x + i), FAST)); \
+        } \
+        for (; i < n; i++) x[i] = SCALAR(x[i], FAST); \
+    }
+
+ACT_DEFINE_AVX2_ROW(ActExpApproxAVX2, ActExpAVX2, ActExpScalar, false)
+ACT_DEFINE_AVX2_ROW(ActExpFastAVX2, ActExpAVX2, ActExpScalar, true)
+ACT_DEFINE_AVX2_ROW(ActSigmoidApproxAVX2, ActSigmoidAVX2, ActSigmoidScalar, false)
+ACT_DEFINE_AVX2_ROW(ActSigmoidFastAVX2, ActSigmoidAVX2, ActSigmoidScalar, true)
+ACT_DEFINE_AVX2_ROW(ActTanhApproxAVX2, ActTanhAVX2, ActTanhScalar, false)
+ACT_DEFINE_AVX2_ROW(ActTanhFastAVX2, ActTanhAVX2, ActTanhScalar, true)
+ACT_DEFINE_AVX2_ROW(ActGeluApproxAVX2, ActGeluAVX2, ActGeluScalar, false)
+ACT_DEFINE_AVX2_ROW(ActGeluFastAVX2, ActGeluAVX2, ActGeluScalar, true)
+
+__attribute__((target("avx2,fma"))) static void
+ActReluAVX2(float32 *x, size_t n)
+{
+    size_t i = 0;
+    __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(x + i, _mm256_max_ps(_mm256_loadu_ps(x + i), zero));
+    }
+    ActReluScalar(x + i, n - i);
+}
+
+// NOTE(liam): with a slope below one, leaky relu is max(x, slope * x).
+__attribute__((target("avx2,fma"))) static void
+ActLeakyReluAVX2(float32 *x, size_t n)
+{
+    size_t i = 0;
+    __m256 slope = _mm256_set1_ps(ACTIVATION_LEAKY_SLOPE);
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 v = _mm256_loadu_ps(x + i);
+        _mm256_storeu_ps(x + i, _mm256_max_ps(v, _mm256_mul_ps(v, slope)));
+    }
+    ActLeakyReluScalar(x + i, n - i);
+}
+
+////////////////////////////////
+// NOTE(liam): avx-512, 16 lanes with masked tails.
+
+__attribute__((target("avx512f"))) static inline __m512
+ActExpAVX512(__m512 x, bool32 fast)
+{
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(ACT_EXP_LO)), _mm512_set1_ps(ACT_EXP_HI));
+    __m512 fn = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(ACT_LOG2E)),
+                                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(ACT_LN2_HI), x);
+    r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(ACT_LN2_LO), r);
+
+    __m512 p;
+    if (fast)
+    {
+        p = _mm512_set1_ps(ACT_EXP_F0);
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(ACT_EXP_F1));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(0.5f));
+    }
+    else
+    {
+        p = _mm512_set1_ps(ACT_EXP_P0);
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(ACT_EXP_P1));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(ACT_EXP_P2));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(ACT_EXP_P3));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(ACT_EXP_P4));
+        p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(ACT_EXP_P5));
+    }
+    p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), _mm512_add_ps(r, _mm512_set1_ps(1.f)));
+
+    // NOTE(liam): scalef computes p * 2^fn directly.
+    return _mm512_scalef_ps(p, fn);
+}
+
+__attribute__((target("avx512f"))) static inline __m512
+ActSigmoidAVX512(__m512 x, bool32 fast)
+{
+    __m512 one = _mm512_set1_ps(1.f);
+    __m512 e = ActExpAVX512(_mm512_sub_ps(_mm512_setzero_ps(), x), fast);
+    return _mm512_div_ps(one, _mm512_add_ps(one, e));
+}
+
+// NOTE(liam): avx512f has no float and/or, so the sign goes through the
+// integer side.
+__attribute__((target("avx512f"))) static inline __m512
+ActTanhAVX512(__m512 x, bool32 fast)
+{
+    __m512 one = _mm512_set1_ps(1.f);
+    __m512i signMask = _mm512_set1_epi32((int32)0x80000000u);
+    __m512i sign = _mm512_and_si512(_mm512_castps_si512(x), signMask);
+    __m512 ax = _mm512_abs_ps(x);
+    __m512 e = ActExpAVX512(_mm512_mul_ps(ax, _mm512_set1_ps(-2.f)), fast);
+    __m512 t = _mm512_div_ps(_mm512_sub_ps(one, e), _mm512_add_ps(one, e));
+    return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(t), sign));
+}
+
+__attribute__((target("avx512f"))) static inline __m512
+ActGeluAVX512(__m512 x, bool32 fast)
+{
+    __m512 one = _mm512_set1_ps(1.f);
+    if (fast)
+    {
+        __m512 x3 = _mm512_mul_ps(_mm512_mul_ps(x, x), x);
+        __m512 u = _mm512_mul_ps(_mm512_set1_ps(ACT_SQRT2_PI),
+                                 _mm512_fmadd_ps(x3, _mm512_set1_ps(ACT_GELU_CUBIC), x));
+        __m512 e = ActExpAVX512(_mm512_mul_ps(u, _mm512_set1_ps(-2.f)), true);
+        return _mm512_div_ps(x, _mm512_add_ps(one, e));
+    }
+
+    __m512i sign = _mm512_and_si512(_mm512_castps_si512(x), _mm512_set1_epi32((int32)0x80000000u));
+    __m512 t = _mm512_mul_ps(_mm512_abs_ps(x), _mm512_set1_ps(ACT_SQRT1_2));
+    __m512 k = _mm512_div_ps(one, _mm512_fmadd_ps(t, _mm512_set1_ps(ACT_ERF_P), one));
+    __m512 p = _mm512_set1_ps(ACT_ERF_A5);
+    p = _mm512_fmadd_ps(p, k, _mm512_set1_ps(ACT_ERF_A4));
+    p = _mm512_fmadd_ps(p, k, _mm512_set1_ps(ACT_ERF_A3));
+    p = _mm512_fmadd_ps(p, k, _mm512_set1_ps(ACT_ERF_A2));
+    p = _mm512_fmadd_ps(p, k, _mm512_set1_ps(ACT_ERF_A1));
+    p = _mm512_mul_ps(p, k);
+    __m512 e = ActExpAVX512(_mm512_sub_ps(_mm512_setzero_ps(), _mm512_mul_ps(t, t)), false);
+    __m512 erf = _mm512_fnmadd_ps(p, e, one);
+    erf = _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(erf), sign));
+    return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), x), _mm512_add_ps(one, erf));
+}
+
+#define ACT_DEFINE_AVX512_ROW(NAME, FN, FAST) \
+    __attribute__((target("avx512f"))) static void \
+    NAME(float32 *x, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 16 <= n; i += 16) \
+        { \
+            _mm512_storeu_ps(x + i, FN(_mm512_loadu_ps(x + i), FAST)); \
+        } \
+        if (i < n) \
+        { \
+            __mmask16 m = (__mmask16)((1u << (n - i)) - 1); \
+            _mm512_mask_storeu_ps(x + i, m, FN(_mm512_maskz_loadu_ps(m, x + i), FAST)); \
+        } \
+    }
+
+ACT_DEFINE_AVX512_ROW(ActExpApproxAVX512, ActExpAVX512, false)
+ACT_DEFINE_AVX512_ROW(ActExpFastAVX512, ActExpAVX512, true)
+ACT_DEFINE_AVX512_ROW(ActSigmoidApproxAVX512, ActSigmoidAVX512, false)
+ACT_DEFINE_AVX512_ROW(ActSigmoidFastAVX512, ActSigmoidAVX512, true)
+ACT_DEFINE_AVX512_ROW(ActTanhApproxAVX512, ActTanhAVX512, false)
+ACT_DEFINE_AVX512_ROW(ActTanhFastAVX512, ActTanhAVX512, true)
+ACT_DEFINE_AVX512_ROW(ActGeluApproxAVX512, ActGeluAVX512, false)
+ACT_DEFINE_AVX512_ROW(ActGeluFastAVX512, ActGeluAVX512, true)
+
+__attribute__((target("avx512f"))) static inline __m512
+ActReluAVX512Vec(__m512 x, bool32 unused)
+{
+    (void)unused;
+    return _mm512_max_ps(x, _mm512_setzero_ps());
+}
+
+__attribute__((target("avx512f"))) static inline __m512
+ActLeakyReluAVX512Vec(__m512 x, bool32 unused)
+{
+    (void)unused;
+    return _mm512_max_ps(x, _mm512_mul_ps(x, _mm512_set1_ps(ACTIVATION_LEAKY_SLOPE)));
+}
+
+ACT_DEFINE_AVX512_ROW(ActReluAVX512, ActReluAVX512Vec, false)
+ACT_DEFINE_AVX512_ROW(ActLeakyReluAVX512, ActLeakyReluAVX512Vec, false)
+#endif
+
+////////////////////////////////
+// NOTE(liam): softmax is built on the exp row of the same accuracy, so it
+// picks up whatever the current level vectorizes.
+
+static ActivationRowFn *ActivationGetExp(ActivationAccuracy accuracy);
+
+static void
+ActSoftmaxRow(float32 *x, size_t n, ActivationRowFn *expRow)
+{
+    if (!n) return;
+    const SimdKernels *simd = SimdGet();
+
+    float32 m = x[0];
+    for (size_t i = 1; i < n; i++) m = Max(m, x[i]);
+
+    simd->subS(x, x, m, n);
+    expRow(x, n);
+
+    float32 s = 0.f;
+    for (size_t i = 0; i < n; i++) s += x[i];
+    simd->mulS(x, x, 1.f / s, n);
+}
+
+static void
+ActSoftmaxExact(float32 *x, size_t n)
+{
+    ActSoftmaxRow(x, n, ActExpExact);
+}
+
+static void
+ActSoftmaxApprox(float32 *x, size_t n)
+{
+    ActSoftmaxRow(x, n, ActivationGetExp(ActivationAccuracy_Approx));
+}
+
+static void
+ActSoftmaxFast(float32 *x, size_t n)
+{
+    ActSoftmaxRow(x, n, ActivationGetExp(ActivationAccuracy_Fast));
+}
+
+////////////////////////////////
+// NOTE(liam): dispatch tables, [kind][accuracy]. Linear is a no-op and
+// stays NULL so callers can skip the pass entirely.
+
+typedef ActivationRowFn *ActivationTable[Activation_Count][ActivationAccuracy_Count];
+
+static const ActivationTable ActivationTableScalar = {
+    [Activation_Sigmoid]   = { ActSigmoidExact, ActSigmoidApproxScalar, ActSigmoidFastScalar },
+    [Activation_Tanh]      = { ActTanhExact, ActTanhApproxScalar, ActTanhFastScalar },
+    [Activation_Relu]      = { ActReluScalar, ActReluScalar, ActReluScalar },
+    [Activation_LeakyRelu] = { ActLeakyReluScalar, ActLeakyReluScalar, ActLeakyReluScalar },
+    [Activation_Gelu]      = { ActGeluExact, ActGeluApproxScalar, ActGeluFastScalar },
+    [Activation_Softmax]   = { ActSoftmaxExact, ActSoftmaxApprox, ActSoftmaxFast },
+};
+
+#ifdef ACTIVATION_X86
+static const ActivationTable ActivationTableAVX2 = {
+    [Activation_Sigmoid]   = { ActSigmoidExact, ActSigmoidApproxAVX2, ActSigmoidFastAVX2 },
+    [Activation_Tanh]      = { ActTanhExact, ActTanhApproxAVX2, ActTanhFastAVX2 },
+    [Activation_Relu]      = { ActReluAVX2, ActReluAVX2, ActReluAVX2 },
+    [Activation_LeakyRelu] = { ActLeakyReluAVX2, ActLeakyReluAVX2, ActLeakyReluAVX2 },
+    [Activation_Gelu]      = { ActGeluExact, ActGeluApproxAVX2, ActGeluFastAVX2 },
+    [Activation_Softmax]   = { ActSoftmaxExact, ActSoftmaxApprox, ActSoftmaxFast },
+};
+
+static const ActivationTable ActivationTableAVX512 = {
+    [Activation_Sigmoid]   = { ActSigmoidExact, ActSigmoidApproxAVX512, ActSigmoidFastAVX512 },
+    [Activation_Tanh]      = { ActTanhExact, ActTanhApproxAVX512, ActTanhFastAVX512 },
+    [Activation_Relu]      = { ActReluAVX512, ActReluAVX512, ActReluAVX512 },
+    [Activation_LeakyRelu] = { ActLeakyReluAVX512, ActLeakyReluAVX512, ActLeakyReluAVX512 },
+    [Activation_Gelu]      = { ActGeluExact, ActGeluApproxAVX512, ActGeluFastAVX512 },
+    [Activation_Softmax]   = { ActSoftmaxExact, ActSoftmaxApprox, ActSoftmaxFast },
+};
+#endif
+
+static ActivationRowFn *
+ActivationGetExp(ActivationAccuracy accuracy)
+{
+    ActivationRowFn *res = ActExpExact;
+    if (accuracy == ActivationAccuracy_Exact) return res;
+
+    bool32 fast = accuracy == ActivationAccuracy_Fast;
+    res = fast ? ActExpFastScalar : ActExpApproxScalar;
+#ifdef ACTIVATION_X86
+    switch (SimdGet()->level)
+    {
+        case SimdLevel_AVX2:   res = fast ? ActExpFastAVX2 : ActExpApproxAVX2; break;
+        case SimdLevel_AVX512: res = fast ? ActExpFastAVX512 : ActExpApproxAVX512; break;
+        default: break;
+    }
+#endif
+    return res;
+}
+
+const char *
+ActivationName(ActivationKind kind)
+{
+    static const char *names[Activation_Count] = {
+        "sigmoid", "tanh", "relu", "leaky_relu", "gelu", "softmax", "linear",
+    };
+    return kind < Activation_Count ? names[kind] : "unknown";
+}
+
+bool32
+ActivationIsElementwise(ActivationKind kind)
+{
+    return kind != Activation_Softmax;
+}
+
+bool32
+ActivationNeedsZ(ActivationKind kind)
+{
+    return kind == Activation_Gelu;
+}
+
+ActivationRowFn *
+ActivationGetRow(ActivationKind kind, ActivationAccuracy accuracy)
+{
+    if (kind >= Activation_Count || accuracy >= ActivationAccuracy_Count) return NULL;
+
+    const ActivationTable *table = &ActivationTableScalar;
+#ifdef ACTIVATION_X86
+    switch (SimdGet()->level)
+    {
+        case SimdLevel_AVX2:   table = &ActivationTableAVX2; break;
+        case SimdLevel_AVX512: table = &ActivationTableAVX512; break;
+        default: break;
+    }
+#endif
+    return (*table)[kind][accuracy];
+}
+
+void
+ActivationApply(ActivationKind kind, ActivationAccuracy accuracy,
+                float32 *x, size_t rows, size_t cols, size_t stride)
+{
+    ActivationRowFn *fn = ActivationGetRow(kind, accuracy);
+    if (!fn) return;
+
+    if (stride == cols && ActivationIsElementwise(kind))
+    {
+        fn(x, rows * cols);
+        return;
+    }
+    for (size_t i = 0; i < rows; i++)
+    {
+        fn(x + i * stride, cols);
+    }
+}
+
+// NOTE(liam): derivative of the exact definition,
+// gelu'(z) = Phi(z) + z * phi(z).
+static inline float32
+ActGeluGrad(float32 z)
+{
+    float32 cdf = 0.5f * (1.f + erff(z * ACT_SQRT1_2));
+    float32 pdf = 0.39894228040143268f * expf(-0.5f * z * z);
+    return cdf + z * pdf;
+}
+
+void
+ActivationBackward(ActivationKind kind, const float32 *z, const float32 *a,
+                   float32 *delta, size_t rows, size_t cols)
+{
+    size_t n = rows * cols;
+    switch (kind)
+    {
+        case Activation_Sigmoid:
+        {
+            for (size_t i = 0; i < n; i++) delta[i] *= a[i] * (1.f - a[i]);
+        } break;
+        case Activation_Tanh:
+        {
+            for (size_t i = 0; i < n; i++) delta[i] *= 1.f - a[i] * a[i];
+        } break;
+        case Activation_Relu:
+        {
+            for (size_t i = 0; i < n; i++) delta[i] = a[i] > 0.f ? delta[i] : 0.f;
+        } break;
+        case Activation_LeakyRelu:
+        {
+            for (size_t i = 0; i < n; i++) delta[i] *= a[i] > 0.f ? 1.f : ACTIVATION_LEAKY_SLOPE;
+        } break;
+        case Activation_Gelu:
+        {
+            Assert(z && "gelu backward needs the pre-activation");
+            for (size_t i = 0; i < n; i++) delta[i] *= ActGeluGrad(z[i]);
+        } break;
+        case Activation_Softmax:
+        {
+            // NOTE(liam): J^T d for J = diag(a) - a a^T, one row at a time.
+            const SimdKernels *simd = SimdGet();
+            for (size_t r = 0; r < rows; r++)
+            {
+                const float32 *ar = a + r * cols;
+                float32 *dr = delta + r * cols;
+                float32 s = simd->dot(ar, dr, cols);
+                simd->subS(dr, dr, s, cols);
+                simd->mul(dr, dr, ar, cols);
+            }
+        } break;
+        default: break;
+    }
+}
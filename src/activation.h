@@ -0,0 +1,63 @@
+/*
+ * ---------------
+ * Liam Bagabag
+ * Version: 1.0.0
+ * requires: simd.h
+ * ---------------
+ */
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include "def.h"
+
+// NOTE(liam): zero is sigmoid so that a zero-initialized NeuralNet keeps
+// its original behavior.
+typedef enum activation_kind {
+    Activation_Sigmoid,
+    Activation_Tanh,
+    Activation_Relu,
+    Activation_LeakyRelu,
+    Activation_Gelu,
+    Activation_Softmax, // row-wise, not element-wise
+    Activation_Linear,
+    Activation_Count,
+} ActivationKind;
+
+// NOTE(liam): Exact goes through libm, Approx stays within ~1e-6 absolute
+// of it, Fast trades accuracy (~1e-4) for a shorter polynomial.
+typedef enum activation_accuracy {
+    ActivationAccuracy_Exact,
+    ActivationAccuracy_Approx,
+    ActivationAccuracy_Fast,
+    ActivationAccuracy_Count,
+} ActivationAccuracy;
+
+#define ACTIVATION_LEAKY_SLOPE 0.01f
+
+typedef void ActivationRowFn(float32 *x, size_t n);
+
+const char *ActivationName(ActivationKind kind);
+
+// NOTE(liam): true when the activation can be applied to any slice of a
+// row independently (everything but softmax), i.e. inside a GEMM epilogue.
+bool32 ActivationIsElementwise(ActivationKind kind);
+
+// NOTE(liam): true when the derivative cannot be recovered from the
+// activation output alone, so backprop has to keep the pre-activation z.
+bool32 ActivationNeedsZ(ActivationKind kind);
+
+// NOTE(liam): in-place row kernel for the current simd level. NULL for
+// Linear; softmax's kernel expects the full row.
+ActivationRowFn *ActivationGetRow(ActivationKind kind, ActivationAccuracy accuracy);
+
+// NOTE(liam): x[rows x cols] with the given row stride, in place.
+void ActivationApply(ActivationKind kind, ActivationAccuracy accuracy,
+                     float32 *x, size_t rows, size_t cols, size_t stride);
+
+// NOTE(liam): delta *= f'(z) over contiguous [rows x cols], using the
+// output a where that is enough. z may be NULL unless ActivationNeedsZ(kind).
+// for softmax this is the per-row Jacobian-vector product.
+void ActivationBackward(ActivationKind kind, const float32 *z, const float32 *a,
+                        float32 *delta, size_t rows, size_t cols);
+
+#endif //ACTIVATION_H
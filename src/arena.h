@@ -2,7 +2,7 @@
  * ---------------
  * Liam Bagabag
  * Version: a2.0
- * Requires: n/a
+ * Requires: pthreads (ArenaGetScratch)
  * ---------------
  */
 #ifndef ARENA_H
@@ -31,13 +31,46 @@
 #define alignof _Alignof
 // ALIGNMENT END
 
+// NOTE(liam): base/size/pos restore the previous block; flags describe the
+// block this footer sits in.
+#define ARENA_BLOCK_HUGE 0x1 // from the huge page path, never cached
+
 typedef struct memory_arena_footer {
     uint8* base;
     memory_index size;
     memory_index pos;
-    memory_index padding;
+    memory_index flags;
 } ArenaFooter;
 
+// NOTE(liam): released blocks parked for reuse instead of unmapped. class c
+// holds blocks of exactly DEFAULT_BLOCKSIZE << c bytes, so a block taken
+// through a cache is rounded up to its class. blocks above the last class
+// bypass the cache. reused blocks are NOT zeroed, unlike fresh mappings.
+#define ARENA_CACHE_CLASSES 24
+
+typedef struct arena_cache_block {
+    struct arena_cache_block *next;
+} ArenaCacheBlock;
+
+typedef struct ArenaCacheStats {
+    uint64 hits;     // pushes served from a free list
+    uint64 misses;   // pushes that had to map a new block
+    uint64 releases; // blocks parked on a free list
+    uint64 unmapped; // blocks given back to the OS (over the cap or trimmed)
+    memory_index cachedBytes;
+    uint32 cachedBlocks;
+} ArenaCacheStats;
+
+// NOTE(liam): maxBytes caps what stays parked; a release that would go
+// over it unmaps instead. 0 means no cap. the lock is a spin lock, so one
+// cache can be shared by arenas on different threads.
+typedef struct ArenaBlockCache {
+    ArenaCacheBlock *free[ARENA_CACHE_CLASSES];
+    memory_index maxBytes;
+    ArenaCacheStats stats;
+    volatile int32 lock;
+} ArenaBlockCache;
+
 typedef struct memory_arena {
     uint8* base;
     memory_index size;
@@ -47,6 +80,20 @@ typedef struct memory_arena {
 
     uint32 blockCount;
     uint32 tempCount;
+
+    ArenaBlockCache *cache; // NULL maps and unmaps every block directly
+
+    // NOTE(liam): reserve mode, see ArenaReserve. reserved is 0 otherwise.
+    memory_index reserved;
+    memory_index committed;
+    memory_index decommitAbove; // 0 never decommits on ArenaTempEnd
+
+    // NOTE(liam): blocks of at least hugePageThreshold bytes (0 is off) are
+    // asked for in huge pages, see ArenaSetHugePages.
+    memory_index hugePageThreshold;
+    uint32 hugeBlocks;   // got MAP_HUGETLB pages
+    uint32 hugeAdvised;  // fell back to MADV_HUGEPAGE on an aligned mapping
+    uint32 hugeRefused;  // neither was available
 } Arena;
 
 typedef struct memory_arena_temp {
@@ -96,18 +143,73 @@ void ArenaTempCheck(Arena*);
 ArenaTemp ArenaScratchCreate(Arena*);
 #define ArenaScratchFree(t) ArenaTempEnd(t)
 
+// NOTE(liam): every thread owns ARENA_SCRATCH_COUNT scratch arenas of its
+// own. ArenaGetScratch opens a temp scope on the first one that is not in
+// conflicts, which should hold every arena the caller may still push its
+// results into (usually just the arena it was given), so temporaries never
+// interleave with results. their blocks come from and go back to
+// ArenaGlobalCache, so they are NOT zeroed; the arenas are cleared into it
+// when the thread exits.
+#define ARENA_SCRATCH_COUNT 2
+ArenaTemp ArenaGetScratch(Arena **conflicts, uint32 conflictCount);
+#define ArenaReleaseScratch(t) ArenaTempEnd(t)
+
+// NOTE(liam): reserve mode. the arena becomes one contiguous range of
+// reserveBytes of address space, mapped PROT_NONE up front and committed
+// ARENA_COMMIT_GRANULE at a time as pushes reach it. nothing is ever
+// chained, so ArenaTempEnd is a position reset. a push past the
+// reservation fails. the arena must be empty; ArenaClear releases the
+// range and returns it to chained blocks.
+#ifndef ARENA_COMMIT_GRANULE
+# define ARENA_COMMIT_GRANULE Kilobytes(64)
+#endif
+bool32 ArenaReserve(Arena* arena, memory_index reserveBytes);
+// NOTE(liam): returns committed pages past the current position (rounded up
+// to a granule) to the OS. ArenaTempEnd does this by itself when more than
+// decommitAbove bytes would stay committed past the position.
+void ArenaDecommitTail(Arena* arena);
+#define ArenaSetDecommitAbove(arena, bytes) ((arena)->decommitAbove = (bytes))
+
+// NOTE(liam): huge pages. blocks of threshold bytes or more are rounded up
+// to ARENA_HUGE_PAGE_SIZE and mapped with MAP_HUGETLB; when the system has
+// no huge pages reserved they fall back to a 2 MiB aligned mapping with
+// MADV_HUGEPAGE, which transparent huge pages may or may not honour. the
+// arena counts which one each block got. set it before the first push (or
+// before ArenaReserve, which then aligns and advises the whole range and
+// commits in huge pages). blocks above the threshold bypass the cache.
+#define ARENA_HUGE_PAGE_SIZE Megabytes(2)
+#define ArenaSetHugePages(arena, threshold) ((arena)->hugePageThreshold = (threshold))
+// NOTE(liam): bytes of the mapping holding ptr that the kernel actually
+// backs with huge pages right now, from /proc/self/smaps. 0 when unknown.
+memory_index ArenaHugePageBytes(void* ptr);
+
+void ArenaCacheInit(ArenaBlockCache *cache, memory_index maxBytes);
+// NOTE(liam): unmaps parked blocks until at most keepBytes remain; 0 empties
+// the cache.
+void ArenaCacheTrim(ArenaBlockCache *cache, memory_index keepBytes);
+ArenaCacheStats ArenaCacheGetStats(ArenaBlockCache *cache);
+// NOTE(liam): one cache for the whole process, capped at
+// ARENA_GLOBAL_CACHE_BYTES.
+ArenaBlockCache *ArenaGlobalCache(void);
+#ifndef ARENA_GLOBAL_CACHE_BYTES
+# define ARENA_GLOBAL_CACHE_BYTES Megabytes(256)
+#endif
+#define ArenaSetBlockCache(arena, c) ((arena)->cache = (c))
+
 #define ZeroStruct(in) ArenaFillZero(sizeof(in), &(in))
 #define ZeroArray(n, ptr) ArenaFillZero((n)*sizeof((ptr)[0]), (ptr))
 
 #endif //ARENA_H
 
 #ifdef ARENA_IMPLEMENTATION
+#include <pthread.h>
 
 # ifdef ARENA_USEMALLOC
 #  include <stdlib.h>
 #  define AllocateMemory malloc
 #  define DeallocateMemory free
 # else
+#include <stdlib.h>
 #include <sys/mman.h>
 static void* AllocateMemory(memory_index size)
 {
@@ -132,8 +234,234 @@ static void DeallocateMemory(void* ptr, memory_index size)
         perror("Failed Deallocation.");
     }
 }
+
+// NOTE(liam): maps size + align bytes and unmaps the slack on both ends,
+// so the result starts on an align boundary.
+static void* AllocateMemoryAligned(memory_index size, memory_index align, int prot, int flags)
+{
+    uint8* raw = (uint8*)mmap(NULL, size + align, prot, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    uint8* res = (uint8*)AlignPow2((memory_index)raw, align);
+    memory_index head = res - raw;
+    if (head) munmap(raw, head);
+    if (align - head) munmap(res + size, align - head);
+    return(res);
+}
+
+typedef enum arena_huge_kind {
+    ArenaHuge_None,
+    ArenaHuge_Explicit, // MAP_HUGETLB
+    ArenaHuge_Advised,  // MADV_HUGEPAGE
+} ArenaHugeKind;
+
+// NOTE(liam): size must be a multiple of ARENA_HUGE_PAGE_SIZE.
+static void* AllocateMemoryHuge(memory_index size, ArenaHugeKind* kind)
+{
+    *kind = ArenaHuge_None;
+    void* res;
+#ifdef MAP_HUGETLB
+    res = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (res != MAP_FAILED)
+    {
+        *kind = ArenaHuge_Explicit;
+        return(res);
+    }
+#endif
+
+    res = AllocateMemoryAligned(size, ARENA_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, 0);
+    if (!res)
+    {
+        perror("Failed Allocation.");
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (madvise(res, size, MADV_HUGEPAGE) == 0)
+    {
+        *kind = ArenaHuge_Advised;
+    }
+#endif
+    return(res);
+}
 # endif
 
+static void
+ArenaCacheLock(ArenaBlockCache *cache)
+{
+    while (__atomic_exchange_n(&cache->lock, 1, __ATOMIC_ACQUIRE))
+    {
+        while (__atomic_load_n(&cache->lock, __ATOMIC_RELAXED)) {}
+    }
+}
+
+static void
+ArenaCacheUnlock(ArenaBlockCache *cache)
+{
+    __atomic_store_n(&cache->lock, 0, __ATOMIC_RELEASE);
+}
+
+// NOTE(liam): smallest class that fits size, or ARENA_CACHE_CLASSES if none.
+static uint32
+ArenaCacheClass(memory_index size)
+{
+    uint32 res = 0;
+    while (res < ARENA_CACHE_CLASSES && ((memory_index)DEFAULT_BLOCKSIZE << res) < size)
+    {
+        res++;
+    }
+    return(res);
+}
+
+void
+ArenaCacheInit(ArenaBlockCache *cache, memory_index maxBytes)
+{
+    *cache = (ArenaBlockCache){0};
+    cache->maxBytes = maxBytes;
+}
+
+ArenaBlockCache *
+ArenaGlobalCache(void)
+{
+    static ArenaBlockCache global_cache = { .maxBytes = ARENA_GLOBAL_CACHE_BYTES };
+    return(&global_cache);
+}
+
+// NOTE(liam): size is rounded up to the block's class (or to whole huge
+// pages) on the way out, and flags says which path the block came from.
+static void*
+ArenaBlockAcquire(Arena* arena, memory_index *size, memory_index *flags)
+{
+    ArenaBlockCache *cache = arena->cache;
+    *flags = 0;
+
+#ifndef ARENA_USEMALLOC
+    if (arena->hugePageThreshold && *size >= arena->hugePageThreshold)
+    {
+        ArenaHugeKind kind;
+        *size = AlignPow2(*size, ARENA_HUGE_PAGE_SIZE);
+        void* res = AllocateMemoryHuge(*size, &kind);
+        arena->hugeBlocks += kind == ArenaHuge_Explicit;
+        arena->hugeAdvised += kind == ArenaHuge_Advised;
+        arena->hugeRefused += kind == ArenaHuge_None;
+        *flags = ARENA_BLOCK_HUGE;
+        return(res);
+    }
+#endif
+
+    if (!cache)
+    {
+        return(AllocateMemory(*size));
+    }
+
+    uint32 c = ArenaCacheClass(*size);
+    void* res = NULL;
+    if (c < ARENA_CACHE_CLASSES)
+    {
+        *size = (memory_index)DEFAULT_BLOCKSIZE << c;
+
+        ArenaCacheLock(cache);
+        ArenaCacheBlock *block = cache->free[c];
+        if (block)
+        {
+            cache->free[c] = block->next;
+            cache->stats.cachedBytes -= *size;
+            cache->stats.cachedBlocks--;
+            cache->stats.hits++;
+            res = block;
+        }
+        else
+        {
+            cache->stats.misses++;
+        }
+        ArenaCacheUnlock(cache);
+    }
+    else
+    {
+        ArenaCacheLock(cache);
+        cache->stats.misses++;
+        ArenaCacheUnlock(cache);
+    }
+
+    if (!res)
+    {
+        res = AllocateMemory(*size);
+    }
+    return(res);
+}
+
+static void
+ArenaBlockRelease(ArenaBlockCache *cache, void* block, memory_index size, memory_index flags)
+{
+    // NOTE(liam): a huge block can have a class size, but parking it would
+    // hand huge pages to arenas that never asked for them and keep them
+    // out of the kernel's pool.
+    if (cache && !(flags & ARENA_BLOCK_HUGE))
+    {
+        uint32 c = ArenaCacheClass(size);
+        bool32 parked = false;
+
+        ArenaCacheLock(cache);
+        if (c < ARENA_CACHE_CLASSES && ((memory_index)DEFAULT_BLOCKSIZE << c) == size &&
+            (!cache->maxBytes || cache->stats.cachedBytes + size <= cache->maxBytes))
+        {
+            ArenaCacheBlock *node = (ArenaCacheBlock*)block;
+            node->next = cache->free[c];
+            cache->free[c] = node;
+            cache->stats.cachedBytes += size;
+            cache->stats.cachedBlocks++;
+            cache->stats.releases++;
+            parked = true;
+        }
+        else
+        {
+            cache->stats.unmapped++;
+        }
+        ArenaCacheUnlock(cache);
+
+        if (parked) return;
+    }
+    DeallocateMemory(block, size);
+}
+
+void
+ArenaCacheTrim(ArenaBlockCache *cache, memory_index keepBytes)
+{
+    // NOTE(liam): largest classes go first; they hold the most memory.
+    for (uint32 c = ARENA_CACHE_CLASSES; c-- > 0;)
+    {
+        memory_index size = (memory_index)DEFAULT_BLOCKSIZE << c;
+        for (;;)
+        {
+            ArenaCacheLock(cache);
+            ArenaCacheBlock *block = cache->stats.cachedBytes > keepBytes ? cache->free[c] : NULL;
+            if (block)
+            {
+                cache->free[c] = block->next;
+                cache->stats.cachedBytes -= size;
+                cache->stats.cachedBlocks--;
+                cache->stats.unmapped++;
+            }
+            ArenaCacheUnlock(cache);
+
+            if (!block) break;
+            DeallocateMemory(block, size);
+        }
+    }
+}
+
+ArenaCacheStats
+ArenaCacheGetStats(ArenaBlockCache *cache)
+{
+    ArenaCacheLock(cache);
+    ArenaCacheStats res = cache->stats;
+    ArenaCacheUnlock(cache);
+    return(res);
+}
+
 void
 ArenaFillZero(memory_index size, void *ptr) // effectively memcpy
 {
@@ -201,11 +529,145 @@ GetFooter(Arena* arena)
     return(res);
 }
 
+// NOTE(liam): a huge-page reservation commits whole huge pages, so the
+// kernel can back each one with a single TLB entry.
+static memory_index
+ArenaCommitGranule(Arena* arena)
+{
+    return(arena->hugePageThreshold ? Max(ARENA_COMMIT_GRANULE, ARENA_HUGE_PAGE_SIZE) : ARENA_COMMIT_GRANULE);
+}
+
+bool32
+ArenaReserve(Arena* arena, memory_index reserveBytes)
+{
+    Assert(!arena->blockCount && !arena->reserved && "reserve mode needs an empty arena.");
+
+#ifdef ARENA_USEMALLOC
+    (void)reserveBytes;
+    return(false);
+#else
+    memory_index granule = ArenaCommitGranule(arena);
+    reserveBytes = AlignPow2(reserveBytes, granule);
+    void* base = AllocateMemoryAligned(reserveBytes, granule, PROT_NONE, MAP_NORESERVE);
+    if (!base)
+    {
+        perror("Failed Reservation.");
+        return(false);
+    }
+#ifdef MADV_HUGEPAGE
+    if (arena->hugePageThreshold)
+    {
+        bool32 advised = madvise(base, reserveBytes, MADV_HUGEPAGE) == 0;
+        arena->hugeAdvised += advised;
+        arena->hugeRefused += !advised;
+    }
+#endif
+
+    arena->base = (uint8*)base;
+    arena->size = reserveBytes;
+    arena->pos = 0;
+    arena->reserved = reserveBytes;
+    arena->committed = 0;
+    arena->blockCount = 1;
+    return(true);
+#endif
+}
+
+#ifndef ARENA_USEMALLOC
+static bool32
+ArenaCommit(Arena* arena, memory_index end)
+{
+    if (end <= arena->committed) return(true);
+
+    end = Min(AlignPow2(end, ArenaCommitGranule(arena)), arena->reserved);
+    if (mprotect(arena->base + arena->committed, end - arena->committed, PROT_READ | PROT_WRITE) == -1)
+    {
+        perror("Failed Commit.");
+        return(false);
+    }
+    arena->committed = end;
+    return(true);
+}
+
+void
+ArenaDecommitTail(Arena* arena)
+{
+    memory_index keep = AlignPow2(arena->pos, ArenaCommitGranule(arena));
+    if (!arena->reserved || keep >= arena->committed) return;
+
+    // NOTE(liam): DONTNEED drops the pages, so a later commit sees zeroes
+    // again; PROT_NONE makes a stray touch fault instead of refaulting.
+    uint8* tail = arena->base + keep;
+    madvise(tail, arena->committed - keep, MADV_DONTNEED);
+    mprotect(tail, arena->committed - keep, PROT_NONE);
+    arena->committed = keep;
+}
+
+memory_index
+ArenaHugePageBytes(void* ptr)
+{
+    FILE* f = fopen("/proc/self/smaps", "r");
+    if (!f) return(0);
+
+    memory_index res = 0;
+    memory_index at = (memory_index)ptr;
+    bool32 inside = false;
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        unsigned long start, end, kb;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+        {
+            inside = at >= start && at < end;
+        }
+        else if (inside && (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1 ||
+                            sscanf(line, "Private_Hugetlb: %lu kB", &kb) == 1 ||
+                            sscanf(line, "Shared_Hugetlb: %lu kB", &kb) == 1))
+        {
+            res += (memory_index)kb * 1024;
+        }
+    }
+    fclose(f);
+    return(res);
+}
+#else
+void
+ArenaDecommitTail(Arena* arena)
+{
+    (void)arena;
+}
+
+memory_index
+ArenaHugePageBytes(void* ptr)
+{
+    (void)ptr;
+    return(0);
+}
+#endif
+
 void*
 ArenaPush(Arena* arena, memory_index sizeInit, memory_index alignment)
 {
     if (!alignment) alignment = DEFAULT_ALIGNMENT;
 
+#ifndef ARENA_USEMALLOC
+    if (arena->reserved)
+    {
+        memory_index size = ArenaGetEffectiveSize(arena, sizeInit, alignment);
+        // NOTE(liam): a reservation is sized up front; running past it is a
+        // sizing bug, not something callers are expected to recover from.
+        if (arena->pos + size > arena->reserved || !ArenaCommit(arena, arena->pos + size))
+        {
+            fprintf(stderr, "arena reservation of %zu bytes exhausted.\n", (size_t)arena->reserved);
+            abort();
+        }
+
+        void* res = (void*)(arena->base + arena->pos + ArenaGetAlignmentOffset(arena, alignment));
+        arena->pos += size;
+        return(res);
+    }
+#endif
+
     //NOTE(liam): rounds allocation up to set align properly.
     memory_index size = ArenaGetEffectiveSize(arena, sizeInit, alignment);
 
@@ -227,8 +689,8 @@ ArenaPush(Arena* arena, memory_index sizeInit, memory_index alignment)
         // NOTE(liam): base should automatically align after allocating again.
         size = sizeInit;
         memory_index blockSize = Max(size + sizeof(struct memory_arena_footer), arena->minimumBlockSize);
+        arena->base = (uint8*)ArenaBlockAcquire(arena, &blockSize, &save.flags);
         arena->size = blockSize - sizeof(struct memory_arena_footer);
-        arena->base = (uint8*)AllocateMemory(blockSize);
         arena->pos = 0;
         arena->blockCount++;
 
@@ -238,7 +700,7 @@ ArenaPush(Arena* arena, memory_index sizeInit, memory_index alignment)
     Assert(((arena->pos + size) <= arena->size) && "new allocation of dynamic arena somehow failed...");
 
     memory_index alignmentOffset = ArenaGetAlignmentOffset(arena, alignment);
-    void* res = (void*)(arena->base + arena->pos - alignmentOffset);
+    void* res = (void*)(arena->base + arena->pos + alignmentOffset);
     arena->pos += size;
 
     Assert((size >= sizeInit) && "requested alloc exceeds arena size after alignment.");
@@ -284,6 +746,18 @@ ArenaPop(Arena* arena, memory_index size)
 void
 ArenaClear(Arena *arena)
 {
+#ifndef ARENA_USEMALLOC
+    if (arena->reserved)
+    {
+        munmap(arena->base, arena->reserved);
+        arena->base = NULL;
+        arena->size = arena->pos = 0;
+        arena->reserved = arena->committed = 0;
+        arena->blockCount = 0;
+        return;
+    }
+#endif
+
     while (arena->blockCount)
     {
         ArenaFreeCurrentBlock(arena);
@@ -294,7 +768,7 @@ ArenaClear(Arena *arena)
 ArenaTemp
 ArenaTempBegin(Arena *arena)
 {
-    ArenaTemp res;
+    ArenaTemp res = {0};
 
     res.arena = arena;
     res.base = arena->base;
@@ -308,16 +782,21 @@ ArenaTempBegin(Arena *arena)
 void
 ArenaFreeCurrentBlock(Arena* arena)
 {
+    // NOTE(liam): a reservation is a single range and only ArenaClear
+    // releases it.
+    Assert(!arena->reserved && "reserve-mode arenas have no blocks to free.");
+
     void* freedBlock = arena->base;
     memory_index freedBlockSize = arena->size;
 
     ArenaFooter* footer = GetFooter(arena);
+    memory_index freedFlags = footer->flags;
 
     arena->base = footer->base;
     arena->size = footer->size;
     arena->pos  = footer->pos;
 
-    DeallocateMemory(freedBlock, freedBlockSize);
+    ArenaBlockRelease(arena->cache, freedBlock, freedBlockSize + sizeof(struct memory_arena_footer), freedFlags);
 
     arena->blockCount--;
 }
@@ -335,6 +814,11 @@ ArenaTempEnd(ArenaTemp temp)
     Assert((arena->pos >= temp.pos) && "Arena position is less than temporary memory's position. Likely user-coded error.");
     arena->pos = temp.pos;
 
+    if (arena->decommitAbove && arena->committed > arena->pos + arena->decommitAbove)
+    {
+        ArenaDecommitTail(arena);
+    }
+
     Assert((arena->tempCount > 0) && "Attempt to decrement Arena's temporary memory count when it is already 0.");
     arena->tempCount--;
 }
@@ -358,4 +842,63 @@ ArenaScratchCreate(Arena* arena)
     return temp;
 }
 
+static threadvar Arena ArenaThreadScratch[ARENA_SCRATCH_COUNT];
+static threadvar bool32 ArenaThreadScratchKeyed;
+static pthread_key_t ArenaScratchKey;
+static pthread_once_t ArenaScratchOnce = PTHREAD_ONCE_INIT;
+
+static void
+ArenaScratchThreadFree(void* ptr)
+{
+    Arena* scratch = (Arena*)ptr;
+    for (uint32 s = 0; s < ARENA_SCRATCH_COUNT; s++)
+    {
+        ArenaClear(scratch + s);
+    }
+}
+
+static void
+ArenaScratchKeyCreate(void)
+{
+    pthread_key_create(&ArenaScratchKey, ArenaScratchThreadFree);
+}
+
+ArenaTemp
+ArenaGetScratch(Arena **conflicts, uint32 conflictCount)
+{
+    // NOTE(liam): the key only exists to get the destructor called.
+    if (!ArenaThreadScratchKeyed)
+    {
+        pthread_once(&ArenaScratchOnce, ArenaScratchKeyCreate);
+        pthread_setspecific(ArenaScratchKey, ArenaThreadScratch);
+        ArenaThreadScratchKeyed = true;
+
+        // NOTE(liam): a scope on an empty scratch arena maps its block and
+        // gives it back at release; through the shared cache that is a
+        // free-list pop and push instead of mmap and munmap.
+        for (uint32 s = 0; s < ARENA_SCRATCH_COUNT; s++)
+        {
+            ArenaSetBlockCache(ArenaThreadScratch + s, ArenaGlobalCache());
+        }
+    }
+
+    Arena* res = NULL;
+    for (uint32 s = 0; s < ARENA_SCRATCH_COUNT && !res; s++)
+    {
+        res = ArenaThreadScratch + s;
+        for (uint32 c = 0; c < conflictCount; c++)
+        {
+            if (conflicts[c] == res)
+            {
+                res = NULL;
+                break;
+            }
+        }
+    }
+    Assert(res && "every scratch arena conflicts; raise ARENA_SCRATCH_COUNT.");
+    if (!res) res = ArenaThreadScratch;
+
+    return(ArenaTempBegin(res));
+}
+
 #endif // ARENA_IMPLEMENTATION
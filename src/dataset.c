@@ -0,0 +1,433 @@
+#include "dataset.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static bool32
+DatasetReadAt(int fd, void *data, size_t size, off_t offset)
+{
+    uint8 *p = data;
+    while (size)
+    {
+        ssize_t got = pread(fd, p, size, offset);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        size -= got;
+        offset += got;
+    }
+    return true;
+}
+
+// NOTE(liam): splits the interleaved records into the x and y rows.
+static void
+DatasetDecode(DatasetStream *ds, DatasetSlot *slot)
+{
+    size_t xBytes = ds->config.inputSize * sizeof(float32);
+    size_t yBytes = ds->config.outputSize * sizeof(float32);
+    const uint8 *record = slot->raw;
+
+    for (uint32 r = 0; r < slot->rows; r++)
+    {
+        memcpy(slot->x.V + (size_t)r * ds->config.inputSize, record, xBytes);
+        memcpy(slot->y.V + (size_t)r * ds->config.outputSize, record + xBytes, yBytes);
+        record += ds->recordBytes;
+    }
+}
+
+static void *
+DatasetProducer(void *ctx)
+{
+    DatasetStream *ds = ctx;
+    uint32 ringSize = ds->config.ringSize;
+    uint64 index = 0;
+
+    for (uint32 e = 0; e < ds->config.epochs; e++)
+    {
+        for (uint64 b = 0; b < ds->batchesPerEpoch; b++, index++)
+        {
+            pthread_mutex_lock(&ds->lock);
+            float64 start = TimeNow();
+            while (ds->filled + ds->holding >= ringSize && !ds->quit)
+            {
+                pthread_cond_wait(&ds->freed, &ds->lock);
+            }
+            ds->stats.producerWaitSeconds += TimeNow() - start;
+            bool32 quit = ds->quit;
+            DatasetSlot *slot = ds->slots + (ds->head + ds->filled) % ringSize;
+            pthread_mutex_unlock(&ds->lock);
+
+            if (quit) goto finish;
+
+            // NOTE(liam): the slot is not visible to the consumer until
+            // filled moves past it, so it is read and decoded unlocked.
+            uint64 first = b * ds->config.batchSize;
+            slot->rows = (uint32)Min((uint64)ds->config.batchSize, ds->recordCount - first);
+            slot->epoch = e;
+            slot->index = index;
+            slot->x.rows = slot->rows;
+            slot->y.rows = slot->rows;
+
+            size_t bytes = (size_t)slot->rows * ds->recordBytes;
+            float64 readStart = TimeNow();
+            bool32 ok = DatasetReadAt(ds->fd, slot->raw, bytes,
+                                      (off_t)(ds->config.headerBytes + first * ds->recordBytes));
+            if (ok) DatasetDecode(ds, slot);
+            float64 readSeconds = TimeNow() - readStart;
+
+            pthread_mutex_lock(&ds->lock);
+            ds->stats.readSeconds += readSeconds;
+            if (ok)
+            {
+                ds->stats.bytesRead += bytes;
+                ds->filled++;
+                pthread_cond_signal(&ds->ready);
+            }
+            else
+            {
+                ds->failed = true;
+            }
+            pthread_mutex_unlock(&ds->lock);
+
+            if (!ok) goto finish;
+        }
+    }
+
+finish:
+    pthread_mutex_lock(&ds->lock);
+    ds->done = true;
+    pthread_cond_signal(&ds->ready);
+    pthread_mutex_unlock(&ds->lock);
+    return NULL;
+}
+
+bool32
+DatasetOpen(Arena *arena, DatasetStream *ds, DatasetConfig config)
+{
+    *ds = (DatasetStream){0};
+    ds->fd = -1;
+
+    config.ringSize = config.ringSize ? Max(config.ringSize, 2) : 3;
+    config.epochs = Max(config.epochs, 1);
+    config.batchSize = Max(config.batchSize, 1);
+    ds->config = config;
+    ds->recordBytes = (size_t)(config.inputSize + config.outputSize) * sizeof(float32);
+
+    ds->fd = open(config.path, O_RDONLY);
+    struct stat st;
+    if (ds->fd < 0 || fstat(ds->fd, &st) != 0)
+    {
+        fprintf(stderr, "dataset failed! %s: %s\n", config.path, strerror(errno));
+        DatasetClose(ds);
+        return false;
+    }
+
+    uint64 size = (uint64)st.st_size;
+    if (size < config.headerBytes || (size - config.headerBytes) % ds->recordBytes != 0)
+    {
+        fprintf(stderr, "dataset failed! %s is not a whole number of %zu-byte records.\n",
+                config.path, ds->recordBytes);
+        DatasetClose(ds);
+        return false;
+    }
+    ds->recordCount = (size - config.headerBytes) / ds->recordBytes;
+    ds->batchesPerEpoch = (ds->recordCount + config.batchSize - 1) / config.batchSize;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(ds->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    ds->slots = PushArray(arena, DatasetSlot, config.ringSize);
+    for (uint32 s = 0; s < config.ringSize; s++)
+    {
+        DatasetSlot *slot = ds->slots + s;
+        *slot = (DatasetSlot){0};
+        slot->raw = PushArrayAlign(arena, uint8, (size_t)config.batchSize * ds->recordBytes, 64);
+        slot->x = MatrixAlloc(config.batchSize, config.inputSize,
+                              PushArrayAlign(arena, float32, (size_t)config.batchSize * config.inputSize, 64));
+        slot->y = MatrixAlloc(config.batchSize, config.outputSize,
+                              PushArrayAlign(arena, float32, (size_t)config.batchSize * config.outputSize, 64));
+    }
+
+    pthread_mutex_init(&ds->lock, NULL);
+    pthread_cond_init(&ds->ready, NULL);
+    pthread_cond_init(&ds->freed, NULL);
+    if (pthread_create(&ds->thread, NULL, DatasetProducer, ds) != 0)
+    {
+        pthread_mutex_destroy(&ds->lock);
+        pthread_cond_destroy(&ds->ready);
+        pthread_cond_destroy(&ds->freed);
+        ds->slots = NULL;
+        DatasetClose(ds);
+        return false;
+    }
+    return true;
+}
+
+bool32
+DatasetNext(DatasetStream *ds, DatasetBatch *batch)
+{
+    pthread_mutex_lock(&ds->lock);
+
+    if (ds->holding)
+    {
+        ds->holding = false;
+        pthread_cond_signal(&ds->freed);
+    }
+
+    float64 start = TimeNow();
+    while (!ds->filled && !ds->done)
+    {
+        pthread_cond_wait(&ds->ready, &ds->lock);
+    }
+    ds->stats.consumerWaitSeconds += TimeNow() - start;
+
+    bool32 res = ds->filled > 0;
+    if (res)
+    {
+        DatasetSlot *slot = ds->slots + ds->head;
+        ds->head = (ds->head + 1) % ds->config.ringSize;
+        ds->filled--;
+        ds->holding = true;
+        ds->stats.batches++;
+
+        batch->x = slot->x;
+        batch->y = slot->y;
+        batch->epoch = slot->epoch;
+        batch->index = slot->index;
+    }
+
+    pthread_mutex_unlock(&ds->lock);
+    return res;
+}
+
+void
+DatasetClose(DatasetStream *ds)
+{
+    if (ds->slots)
+    {
+        pthread_mutex_lock(&ds->lock);
+        ds->quit = true;
+        pthread_cond_broadcast(&ds->freed);
+        pthread_mutex_unlock(&ds->lock);
+
+        pthread_join(ds->thread, NULL);
+        pthread_mutex_destroy(&ds->lock);
+        pthread_cond_destroy(&ds->ready);
+        pthread_cond_destroy(&ds->freed);
+        ds->slots = NULL;
+    }
+    if (ds->fd >= 0) close(ds->fd);
+    ds->fd = -1;
+}
+
+bool32
+DatasetWrite(const char *path, Matrix x, Matrix y)
+{
+    Assert(x.rows == y.rows && "one target row per input row");
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        fprintf(stderr, "dataset failed! %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    bool32 res = true;
+    for (size_t r = 0; res && r < x.rows; r++)
+    {
+        res = fwrite(&MatrixAT(x, r, 0), sizeof(float32), x.cols, f) == x.cols &&
+              fwrite(&MatrixAT(y, r, 0), sizeof(float32), y.cols, f) == y.cols;
+    }
+    res = fclose(f) == 0 && res;
+    return res;
+}
+
+void
+NeuralNetLearnStream(Arena *arena, NeuralNet nn, DatasetStream *ds, float32 rate)
+{
+    ArenaTemp tmp = ArenaGetScratch(&arena, 1);
+    NeuralWorkspace ws = {0};
+    NeuralWorkspaceInit(tmp.arena, &ws, nn, ds->config.batchSize);
+
+    DatasetBatch batch;
+    while (DatasetNext(ds, &batch))
+    {
+        NeuralNetStep(&ws, nn, batch.x, batch.y, rate);
+    }
+    ArenaReleaseScratch(tmp);
+}
+
+bool32
+DatasetFileWrite(const char *path, Matrix x, Matrix y)
+{
+    Assert(x.rows == y.rows && "one target row per input row");
+
+    DatasetFileHeader header = {0};
+    header.magic = DATASET_FILE_MAGIC;
+    header.version = DATASET_FILE_VERSION;
+    header.rowCount = x.rows;
+    header.inputSize = (uint32)x.cols;
+    header.outputSize = (uint32)y.cols;
+    header.targetOffset = (uint32)AlignPow2(x.cols, 16);
+    header.rowStride = header.targetOffset + (uint32)AlignPow2(y.cols, 16);
+    header.dataOffset = sizeof(header);
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        fprintf(stderr, "dataset failed! %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    // NOTE(liam): one row buffer; the padding stays zero.
+    float32 row[header.rowStride];
+    memset(row, 0, sizeof(row));
+
+    bool32 res = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (size_t r = 0; res && r < x.rows; r++)
+    {
+        memcpy(row, &MatrixAT(x, r, 0), x.cols * sizeof(float32));
+        memcpy(row + header.targetOffset, &MatrixAT(y, r, 0), y.cols * sizeof(float32));
+        res = fwrite(row, sizeof(row), 1, f) == 1;
+    }
+    res = fclose(f) == 0 && res;
+    return res;
+}
+
+bool32
+DatasetFileOpen(DatasetFile *df, const char *path)
+{
+    *df = (DatasetFile){0};
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "dataset failed! %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *base = size >= sizeof(DatasetFileHeader)
+               ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        fprintf(stderr, "dataset failed! %s could not be mapped.\n", path);
+        return false;
+    }
+
+    // NOTE(liam): sizes are checked by division and subtraction, so no
+    // product or sum of header fields can wrap past the file size. rows are
+    // indexed with uint32 (see DatasetFileGather).
+    DatasetFileHeader *header = base;
+    uint64 rowBytes = (uint64)header->rowStride * sizeof(float32);
+    bool32 valid = header->magic == DATASET_FILE_MAGIC &&
+                   header->version == DATASET_FILE_VERSION &&
+                   header->dataOffset % 64 == 0 &&
+                   header->dataOffset >= sizeof(DatasetFileHeader) &&
+                   header->dataOffset <= size &&
+                   header->rowStride && header->rowStride % 16 == 0 &&
+                   header->targetOffset >= header->inputSize &&
+                   (uint64)header->targetOffset + header->outputSize <= header->rowStride &&
+                   header->rowCount <= UINT32_MAX &&
+                   header->rowCount <= (size - header->dataOffset) / rowBytes;
+    if (!valid)
+    {
+        fprintf(stderr, "dataset failed! %s is not a valid dataset file.\n", path);
+        munmap(base, size);
+        return false;
+    }
+
+    // NOTE(liam): shuffled epochs touch rows in random order.
+    madvise(base, size, MADV_RANDOM);
+
+    df->mapping = base;
+    df->mappingSize = size;
+    df->rowCount = header->rowCount;
+    df->inputSize = header->inputSize;
+    df->outputSize = header->outputSize;
+    df->rowStride = header->rowStride;
+    df->targetOffset = header->targetOffset;
+    df->rows = (const float32 *)((uint8 *)base + header->dataOffset);
+    return true;
+}
+
+void
+DatasetFileClose(DatasetFile *df)
+{
+    if (df->mapping) munmap(df->mapping, df->mappingSize);
+    *df = (DatasetFile){0};
+}
+
+void
+DatasetFileGather(DatasetFile *df, const uint32 *indices, Matrix x, Matrix y)
+{
+    Assert(x.cols == df->inputSize && y.cols == df->outputSize && y.rows >= x.rows);
+
+    for (size_t i = 0; i < x.rows; i++)
+    {
+        Assert(indices[i] < df->rowCount);
+        const float32 *row = df->rows + (size_t)indices[i] * df->rowStride;
+        SimdGet()->copy(&MatrixAT(x, i, 0), row, x.cols);
+        SimdGet()->copy(&MatrixAT(y, i, 0), row + df->targetOffset, y.cols);
+    }
+}
+
+void
+DatasetFileViews(DatasetFile *df, Matrix *x, Matrix *y)
+{
+    // NOTE(liam): the mapping is read-only; these must never be written.
+    float32 *rows = (float32 *)df->rows;
+    *x = MatrixView(df->rowCount, df->inputSize, df->rowStride, rows);
+    *y = MatrixView(df->rowCount, df->outputSize, df->rowStride, rows + df->targetOffset);
+}
+
+void
+NeuralNetLearnFile(Arena *arena, RandomSeries *series, NeuralNet nn, DatasetFile *df, NeuralLearnConfig config)
+{
+    ArenaTemp tmp = ArenaGetScratch(&arena, 1);
+
+    // NOTE(liam): DatasetFileOpen rejects files over UINT32_MAX rows.
+    uint32 n = (uint32)df->rowCount;
+    uint32 batchSize = config.batchSize ? Min(config.batchSize, n) : n;
+
+    uint32 *order = PushArray(tmp.arena, uint32, n);
+    for (uint32 i = 0; i < n; i++) order[i] = i;
+
+    Matrix x = MatrixArenaAlloc(tmp.arena, batchSize, df->inputSize);
+    Matrix y = MatrixArenaAlloc(tmp.arena, batchSize, df->outputSize);
+    Matrix xAll, yAll;
+    DatasetFileViews(df, &xAll, &yAll);
+    NeuralWorkspace ws = {0};
+    NeuralWorkspaceInit(tmp.arena, &ws, nn, batchSize);
+
+    for (uint32 e = 0; e < config.epochs; e++)
+    {
+        if (config.shuffle) RandomShuffle(series, order, n);
+
+        for (uint32 first = 0; first < n; first += batchSize)
+        {
+            uint32 rows = Min(batchSize, n - first);
+            if (config.shuffle)
+            {
+                Matrix xb = MatrixAlloc(rows, x.cols, x.V);
+                Matrix yb = MatrixAlloc(rows, y.cols, y.V);
+                DatasetFileGather(df, order + first, xb, yb);
+                NeuralNetStep(&ws, nn, xb, yb, config.rate);
+            }
+            else
+            {
+                NeuralNetStep(&ws, nn, MatrixViewRows(xAll, first, first + rows),
+                              MatrixViewRows(yAll, first, first + rows), config.rate);
+            }
+        }
+    }
+
+    ArenaReleaseScratch(tmp);
+}
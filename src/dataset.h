@@ -0,0 +1,148 @@
+/*
+ * ---------------
+ * Liam Bagabag
+ * Version: 1.0.0
+ * requires: network.h, pthreads
+ * ---------------
+ */
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "network.h"
+#include <pthread.h>
+
+// NOTE(liam): a dataset file is headerless: recordCount fixed-size records,
+// each inputSize float32 inputs followed by outputSize float32 targets,
+// native byte order. headerBytes are skipped at the start of the file.
+typedef struct DatasetConfig {
+    const char *path;
+    uint32 inputSize;
+    uint32 outputSize;
+    uint64 headerBytes;
+
+    uint32 batchSize;
+    uint32 ringSize;   // batch buffers in flight, at least 2 (0 picks 3)
+    uint32 epochs;     // passes over the file (0 means 1)
+} DatasetConfig;
+
+// NOTE(liam): one ring slot. raw holds the records as read; x and y are the
+// decoded matrices the trainer sees.
+typedef struct dataset_slot {
+    uint8 *raw;
+    Matrix x;
+    Matrix y;
+    uint32 rows;
+    uint32 epoch;
+    uint64 index; // batch number over the whole stream
+} DatasetSlot;
+
+typedef struct DatasetBatch {
+    Matrix x;
+    Matrix y;
+    uint32 epoch;
+    uint64 index;
+} DatasetBatch;
+
+// NOTE(liam): waits are time spent blocked on the other side; a consumer
+// that never waits was never stalled on I/O.
+typedef struct DatasetStats {
+    uint64 batches;
+    uint64 bytesRead;
+    float64 readSeconds;
+    float64 consumerWaitSeconds;
+    float64 producerWaitSeconds;
+} DatasetStats;
+
+// NOTE(liam): a background thread reads and decodes batch k+1 (and on up
+// to the ring size) while the caller works on batch k. the slot handed
+// out by DatasetNext stays the caller's until the next call.
+typedef struct DatasetStream {
+    DatasetConfig config;
+    int fd;
+    uint64 recordCount;
+    size_t recordBytes;
+    uint64 batchesPerEpoch;
+
+    DatasetSlot *slots;
+    uint32 head;   // next slot the consumer takes
+    uint32 filled; // slots ready to be taken
+    bool32 holding; // the consumer has the slot before head
+    bool32 done;    // the producer has queued its last batch
+    bool32 failed;
+    bool32 quit;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready; // a slot was filled
+    pthread_cond_t freed; // a slot was handed back
+
+    DatasetStats stats;
+} DatasetStream;
+
+// NOTE(liam): the ring is allocated from arena; nothing is allocated while
+// streaming.
+bool32 DatasetOpen(Arena *arena, DatasetStream *ds, DatasetConfig config);
+// NOTE(liam): false once every epoch has been handed out (or on a read
+// error, see ds->failed).
+bool32 DatasetNext(DatasetStream *ds, DatasetBatch *batch);
+void DatasetClose(DatasetStream *ds);
+
+// NOTE(liam): writes x and y row by row in the record layout above.
+bool32 DatasetWrite(const char *path, Matrix x, Matrix y);
+
+// NOTE(liam): one NeuralNetStep per streamed batch, in file order.
+// like NeuralNetLearnFile, the workspace lives in the calling thread's
+// scratch arenas (ArenaGetScratch); nothing is pushed into arena.
+void NeuralNetLearnStream(Arena *arena, NeuralNet nn, DatasetStream *ds, float32 rate);
+
+// NOTE(liam): dataset container, meant to be mapped rather than read.
+// little-endian, laid out as
+//   header (64 bytes) | rows
+// where each row is rowStride floats: the inputs, padded to 16 floats,
+// then the targets, padded to 16 floats. every row starts 64-byte aligned.
+#define DATASET_FILE_MAGIC   0x3153444Eu // "NDS1"
+#define DATASET_FILE_VERSION 1
+
+typedef struct dataset_file_header {
+    uint32 magic;
+    uint32 version;
+    uint64 rowCount;
+    uint32 inputSize;
+    uint32 outputSize;
+    uint32 rowStride;    // floats
+    uint32 targetOffset; // floats from the start of a row
+    uint64 dataOffset;   // bytes from the start of the file
+    uint8 reserved[24];
+} DatasetFileHeader;
+
+typedef struct DatasetFile {
+    void *mapping;
+    size_t mappingSize;
+
+    uint64 rowCount;
+    uint32 inputSize;
+    uint32 outputSize;
+    size_t rowStride;
+    size_t targetOffset;
+    const float32 *rows;
+} DatasetFile;
+
+bool32 DatasetFileWrite(const char *path, Matrix x, Matrix y);
+bool32 DatasetFileOpen(DatasetFile *df, const char *path);
+void DatasetFileClose(DatasetFile *df);
+// NOTE(liam): x/y row i = record indices[i], for every row of x; the
+// mapping itself is never written.
+void DatasetFileGather(DatasetFile *df, const uint32 *indices, Matrix x, Matrix y);
+// NOTE(liam): every input and every target as strided views straight into
+// the mapping (stride rowStride); read-only, nothing is copied.
+void DatasetFileViews(DatasetFile *df, Matrix *x, Matrix *y);
+
+// NOTE(liam): epochs, rate and batchSize as in NeuralNetLearnWith, and
+// with config.shuffle every epoch visits the rows in a new random order.
+// shuffled batches are gathered straight from the mapping into one buffer;
+// in file order each batch is a view of the mapping and nothing is copied.
+// training runs on the calling thread; threadCount and mode are ignored.
+// the order, batch buffers and workspace live in scratch, not in arena.
+void NeuralNetLearnFile(Arena *arena, RandomSeries *series, NeuralNet nn, DatasetFile *df, NeuralLearnConfig config);
+
+#endif //DATASET_H
@@ -49,11 +49,16 @@
 
 # if defined(COMPILER_CLANG)
 #  define FILE_NAME __FILE_NAME__
-#  define threadvar __thread
 # else
 #  define FILE_NAME __FILE__
 # endif
 
+# if defined(COMPILER_CLANG) || defined(COMPILER_GCC) || defined(COMPILER_TCC)
+#  define threadvar __thread
+# else
+#  define threadvar _Thread_local
+# endif
+
 // aliases
 # define global     static
 # define local      static
@@ -129,6 +134,7 @@ int ap_float(float a, float b);
 
 # define ArrayCount(a) (sizeof(a)/sizeof(*(a)))
 # define IsPowerOfTwo(n) (((n) & ((n) - 1)) == 0)
+# define AlignPow2(x, b) (((x) + (b) - 1) & ~((b) - 1))
 
 # define Kilobytes(V) ((V)*1024LL)
 # define Megabytes(V) (Kilobytes(V)*1024LL)
@@ -145,6 +151,16 @@ int ap_float(float a, float b);
 # define IntFromPtr(p) (unsigned long long)((char*)p - (char*)0)
 # define PtrFromInt(n) (void*)((char*)0 + (n))
 
+// NOTE(liam): monotonic clock in seconds, for timing and deadlines.
+# include <time.h>
+static inline float64
+TimeNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (float64)ts.tv_sec + (float64)ts.tv_nsec * 1e-9;
+}
+
 // NOTE(liam): behavior of assert.
 # if !defined(AssertBreak)
 #  include <stdlib.h>
@@ -0,0 +1,660 @@
+#include "gemm.h"
+#include "simd.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#if defined(ARCH_X64) || defined(ARCH_X86)
+# include <immintrin.h>
+# define GEMM_X86 1
+#endif
+
+// NOTE(liam): blocking follows the usual Goto layout:
+// a KC x NR sliver of packed B stays in L1 while the micro-kernel sweeps
+// down an MC x KC block of packed A (L2), and the KC x NC block of packed B
+// lives in L3. MC/NC must be multiples of every kernel's MR/NR so that
+// zero-padded edge panels still fit the packing buffers.
+#define GEMM_MC 120
+#define GEMM_KC 256
+#define GEMM_NC 2048
+
+#define GEMM_MR_MAX 6
+#define GEMM_NR_MAX 16
+
+// NOTE(liam): under this many multiply-adds (or for a handful of rows, i.e.
+// the single example forward pass) packing costs more than it saves.
+#define GEMM_SMALL_ROWS 4
+#define GEMM_SMALL_VOLUME (32 * 32 * 32)
+
+typedef void GemmMicroKernel(size_t kc, const float32 *pa, const float32 *pb,
+                             float32 *c, size_t ldc, bool32 accumulate);
+
+typedef struct gemm_kernel {
+    uint32 mr;
+    uint32 nr;
+    GemmMicroKernel *fn;
+} GemmKernel;
+
+typedef struct gemm_buffers {
+    float32 *a; // GEMM_MC x GEMM_KC
+    float32 *b; // GEMM_KC x GEMM_NC
+} GemmBuffers;
+
+static threadvar GemmBuffers GemmThreadBuffers;
+static pthread_key_t GemmBufferKey;
+static pthread_once_t GemmBufferOnce = PTHREAD_ONCE_INIT;
+
+static void
+GemmBuffersFree(void *ptr)
+{
+    GemmBuffers *buf = (GemmBuffers *)ptr;
+    free(buf->a);
+    free(buf->b);
+    buf->a = NULL;
+    buf->b = NULL;
+}
+
+static void
+GemmBufferKeyCreate(void)
+{
+    pthread_key_create(&GemmBufferKey, GemmBuffersFree);
+}
+
+// NOTE(liam): packing buffers are per thread and released when the thread
+// exits (the key only exists to get the destructor called).
+static GemmBuffers *
+GemmGetBuffers(void)
+{
+    GemmBuffers *buf = &GemmThreadBuffers;
+    if (!buf->a)
+    {
+        pthread_once(&GemmBufferOnce, GemmBufferKeyCreate);
+
+        buf->a = (float32 *)aligned_alloc(64, sizeof(float32) * GEMM_MC * GEMM_KC);
+        buf->b = (float32 *)aligned_alloc(64, sizeof(float32) * GEMM_KC * GEMM_NC);
+        Assert(buf->a && buf->b && "GEMM packing buffer allocation failed.");
+        pthread_setspecific(GemmBufferKey, buf);
+    }
+    return buf;
+}
+
+static void
+GemmKernelScalar(size_t kc, const float32 *pa, const float32 *pb,
+                 float32 *c, size_t ldc, bool32 accumulate)
+{
+    float32 acc[6][16] = {0};
+
+    for (size_t k = 0; k < kc; k++)
+    {
+        for (uint32 i = 0; i < 6; i++)
+        {
+            float32 a = pa[i];
+            for (uint32 j = 0; j < 16; j++)
+            {
+                acc[i][j] += a * pb[j];
+            }
+        }
+        pa += 6;
+        pb += 16;
+    }
+
+    for (uint32 i = 0; i < 6; i++)
+    {
+        float32 *row = c + i * ldc;
+        for (uint32 j = 0; j < 16; j++)
+        {
+            row[j] = accumulate ? row[j] + acc[i][j] : acc[i][j];
+        }
+    }
+}
+
+static const GemmKernel GemmKernelScalarDesc = { 6, 16, GemmKernelScalar };
+
+#ifdef GEMM_X86
+// NOTE(liam): 6x8 tile = 12 xmm accumulators, same register budget as the
+// avx2 kernel at half the width.
+#define GEMM_SSE_ROW(i) \
+    a = _mm_set1_ps(pa[i]); \
+    c##i##0 = _mm_add_ps(c##i##0, _mm_mul_ps(a, b0)); \
+    c##i##1 = _mm_add_ps(c##i##1, _mm_mul_ps(a, b1));
+
+#define GEMM_SSE_STORE(i) \
+    if (accumulate) \
+    { \
+        c##i##0 = _mm_add_ps(c##i##0, _mm_loadu_ps(c + (i) * ldc)); \
+        c##i##1 = _mm_add_ps(c##i##1, _mm_loadu_ps(c + (i) * ldc + 4)); \
+    } \
+    _mm_storeu_ps(c + (i) * ldc, c##i##0); \
+    _mm_storeu_ps(c + (i) * ldc + 4, c##i##1);
+
+__attribute__((target("sse4.1"))) static void
+GemmKernelSse4(size_t kc, const float32 *pa, const float32 *pb,
+               float32 *c, size_t ldc, bool32 accumulate)
+{
+    __m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+    __m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+    __m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+    __m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+    __m128 c40 = _mm_setzero_ps(), c41 = _mm_setzero_ps();
+    __m128 c50 = _mm_setzero_ps(), c51 = _mm_setzero_ps();
+    __m128 a, b0, b1;
+
+    for (size_t k = 0; k < kc; k++)
+    {
+        b0 = _mm_load_ps(pb);
+        b1 = _mm_load_ps(pb + 4);
+
+        GEMM_SSE_ROW(0)
+        GEMM_SSE_ROW(1)
+        GEMM_SSE_ROW(2)
+        GEMM_SSE_ROW(3)
+        GEMM_SSE_ROW(4)
+        GEMM_SSE_ROW(5)
+
+        pa += 6;
+        pb += 8;
+    }
+
+    GEMM_SSE_STORE(0)
+    GEMM_SSE_STORE(1)
+    GEMM_SSE_STORE(2)
+    GEMM_SSE_STORE(3)
+    GEMM_SSE_STORE(4)
+    GEMM_SSE_STORE(5)
+}
+
+static const GemmKernel GemmKernelSse4Desc = { 6, 8, GemmKernelSse4 };
+
+// NOTE(liam): 6x16 tile = 12 ymm accumulators, 2 for the B sliver and
+// 1 for the broadcast A value.
+#define GEMM_AVX2_ROW(i) \
+    a = _mm256_broadcast_ss(pa + (i)); \
+    c##i##0 = _mm256_fmadd_ps(a, b0, c##i##0); \
+    c##i##1 = _mm256_fmadd_ps(a, b1, c##i##1);
+
+#define GEMM_AVX2_STORE(i) \
+    if (accumulate) \
+    { \
+        c##i##0 = _mm256_add_ps(c##i##0, _mm256_loadu_ps(c + (i) * ldc)); \
+        c##i##1 = _mm256_add_ps(c##i##1, _mm256_loadu_ps(c + (i) * ldc + 8)); \
+    } \
+    _mm256_storeu_ps(c + (i) * ldc, c##i##0); \
+    _mm256_storeu_ps(c + (i) * ldc + 8, c##i##1);
+
+__attribute__((target("avx2,fma"))) static void
+GemmKernelAvx2(size_t kc, const float32 *pa, const float32 *pb,
+               float32 *c, size_t ldc, bool32 accumulate)
+{
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+    __m256 a, b0, b1;
+
+    for (size_t k = 0; k < kc; k++)
+    {
+        b0 = _mm256_load_ps(pb);
+        b1 = _mm256_load_ps(pb + 8);
+
+        GEMM_AVX2_ROW(0)
+        GEMM_AVX2_ROW(1)
+        GEMM_AVX2_ROW(2)
+        GEMM_AVX2_ROW(3)
+        GEMM_AVX2_ROW(4)
+        GEMM_AVX2_ROW(5)
+
+        pa += 6;
+        pb += 16;
+    }
+
+    GEMM_AVX2_STORE(0)
+    GEMM_AVX2_STORE(1)
+    GEMM_AVX2_STORE(2)
+    GEMM_AVX2_STORE(3)
+    GEMM_AVX2_STORE(4)
+    GEMM_AVX2_STORE(5)
+}
+
+static const GemmKernel GemmKernelAvx2Desc = { 6, 16, GemmKernelAvx2 };
+#endif
+
+static const GemmKernel *
+GemmSelectKernel(void)
+{
+    const GemmKernel *res = &GemmKernelScalarDesc;
+#ifdef GEMM_X86
+    SimdLevel level = SimdGet()->level;
+    if (level >= SimdLevel_AVX2)
+    {
+        res = &GemmKernelAvx2Desc;
+    }
+    else if (level >= SimdLevel_SSE4)
+    {
+        res = &GemmKernelSse4Desc;
+    }
+#endif
+    return res;
+}
+
+// NOTE(liam): A block (mc x kc) -> row panels of MR, each stored k-major:
+// pa[panel][k][i]. rows past mc are zero so edge tiles need no special case
+// inside the micro-kernel. alpha is folded in here.
+// element (i, k) of op(A) lives at A[i * rs + k * cs], which covers both the
+// plain (rs = lda, cs = 1) and the transposed (rs = 1, cs = lda) layouts.
+static void
+GemmPackA(uint32 mr, size_t mc, size_t kc, float32 alpha,
+          const float32 *A, size_t rs, size_t cs, float32 *pa)
+{
+    for (size_t ip = 0; ip < mc; ip += mr)
+    {
+        size_t rows = Min(mr, mc - ip);
+        for (size_t k = 0; k < kc; k++)
+        {
+            const float32 *src = A + ip * rs + k * cs;
+            size_t i = 0;
+            for (; i < rows; i++)
+            {
+                *pa++ = alpha * src[i * rs];
+            }
+            for (; i < mr; i++)
+            {
+                *pa++ = 0.f;
+            }
+        }
+    }
+}
+
+// NOTE(liam): B block (kc x nc) -> column panels of NR: pb[panel][k][j].
+// element (k, j) of op(B) lives at B[k * rs + j * cs].
+static void
+GemmPackB(uint32 nr, size_t kc, size_t nc,
+          const float32 *B, size_t rs, size_t cs, float32 *pb)
+{
+    for (size_t jp = 0; jp < nc; jp += nr)
+    {
+        size_t cols = Min(nr, nc - jp);
+        for (size_t k = 0; k < kc; k++)
+        {
+            const float32 *src = B + k * rs + jp * cs;
+            size_t j = 0;
+            for (; j < cols; j++)
+            {
+                *pb++ = src[j * cs];
+            }
+            for (; j < nr; j++)
+            {
+                *pb++ = 0.f;
+            }
+        }
+    }
+}
+
+// NOTE(liam): runs on a finished block of C (rows x cols at (row, col))
+// right after it was written, so it is still in L1.
+static void
+GemmApplyEpilogue(const GemmEpilogue *ep, float32 *c, size_t ldc,
+                  size_t row, size_t col, size_t rows, size_t cols)
+{
+    const SimdKernels *simd = SimdGet();
+    for (size_t i = 0; i < rows; i++)
+    {
+        float32 *out = c + i * ldc;
+        if (ep->bias)
+        {
+            simd->add(out, out, ep->bias + col, cols);
+        }
+        if (ep->Z)
+        {
+            simd->copy(ep->Z + (row + i) * ep->ldz + col, out, cols);
+        }
+        if (ep->act)
+        {
+            ep->act(out, cols);
+        }
+    }
+}
+
+// NOTE(liam): C here is the (row0, col0) corner of the full output; ep is
+// only passed on the last K block, once the tile holds its final value.
+static void
+GemmMacroKernel(const GemmKernel *kernel, size_t mc, size_t nc, size_t kc,
+                const float32 *pa, const float32 *pb,
+                float32 *C, size_t ldc, bool32 accumulate,
+                const GemmEpilogue *ep, size_t row0, size_t col0)
+{
+    uint32 mr = kernel->mr;
+    uint32 nr = kernel->nr;
+    _Alignas(64) float32 edge[GEMM_MR_MAX * GEMM_NR_MAX];
+
+    for (size_t jr = 0; jr < nc; jr += nr)
+    {
+        size_t cols = Min(nr, nc - jr);
+        const float32 *panelB = pb + jr * kc;
+
+        for (size_t ir = 0; ir < mc; ir += mr)
+        {
+            size_t rows = Min(mr, mc - ir);
+            const float32 *panelA = pa + ir * kc;
+            float32 *c = C + ir * ldc + jr;
+
+            if (rows == mr && cols == nr)
+            {
+                kernel->fn(kc, panelA, panelB, c, ldc, accumulate);
+            }
+            else
+            {
+                // NOTE(liam): partial tile; run the full kernel into a
+                // scratch tile and copy out only the valid part.
+                kernel->fn(kc, panelA, panelB, edge, nr, false);
+                for (size_t i = 0; i < rows; i++)
+                {
+                    for (size_t j = 0; j < cols; j++)
+                    {
+                        float32 v = edge[i * nr + j];
+                        c[i * ldc + j] = accumulate ? c[i * ldc + j] + v : v;
+                    }
+                }
+            }
+
+            if (ep)
+            {
+                GemmApplyEpilogue(ep, c, ldc, row0 + ir, col0 + jr, rows, cols);
+            }
+        }
+    }
+}
+
+static void
+GemmScaleC(size_t M, size_t N, float32 beta, float32 *C, size_t ldc)
+{
+    const SimdKernels *simd = SimdGet();
+    for (size_t i = 0; i < M; i++)
+    {
+        if (beta == 0.f)
+        {
+            simd->fill(C + i * ldc, 0.f, N);
+        }
+        else
+        {
+            simd->mulS(C + i * ldc, C + i * ldc, beta, N);
+        }
+    }
+}
+
+// NOTE(liam): op(B) plain: i-k-j order, so B and C are both walked along
+// rows. op(B) transposed: every C element is a dot product of two
+// contiguous rows (the A * W^T step of backprop).
+static void
+GemmSmall(GemmOp opA, GemmOp opB, size_t M, size_t N, size_t K,
+          float32 alpha, const float32 *A, size_t lda,
+          const float32 *B, size_t ldb,
+          float32 beta, float32 *C, size_t ldc,
+          const GemmEpilogue *ep)
+{
+    const SimdKernels *simd = SimdGet();
+    size_t ars = (opA == Gemm_N) ? lda : 1;
+    size_t acs = (opA == Gemm_N) ? 1 : lda;
+
+    GemmScaleC(M, N, beta, C, ldc);
+
+    if (opB == Gemm_N)
+    {
+        for (size_t i = 0; i < M; i++)
+        {
+            float32 *c = C + i * ldc;
+            for (size_t k = 0; k < K; k++)
+            {
+                simd->axpy(c, alpha * A[i * ars + k * acs], B + k * ldb, N);
+            }
+        }
+    }
+    else if (opA == Gemm_N)
+    {
+        for (size_t i = 0; i < M; i++)
+        {
+            float32 *c = C + i * ldc;
+            for (size_t j = 0; j < N; j++)
+            {
+                c[j] += alpha * simd->dot(A + i * lda, B + j * ldb, K);
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < M; i++)
+        {
+            float32 *c = C + i * ldc;
+            for (size_t j = 0; j < N; j++)
+            {
+                float32 sum = 0.f;
+                for (size_t k = 0; k < K; k++)
+                {
+                    sum += A[k * lda + i] * B[j * ldb + k];
+                }
+                c[j] += alpha * sum;
+            }
+        }
+    }
+
+    if (ep)
+    {
+        GemmApplyEpilogue(ep, C, ldc, 0, 0, M, N);
+    }
+}
+
+void
+GemmF32(GemmOp opA, GemmOp opB, size_t M, size_t N, size_t K,
+        float32 alpha, const float32 *A, size_t lda,
+        const float32 *B, size_t ldb,
+        float32 beta, float32 *C, size_t ldc)
+{
+    GemmF32Ex(opA, opB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc, NULL);
+}
+
+void
+GemmF32Ex(GemmOp opA, GemmOp opB, size_t M, size_t N, size_t K,
+          float32 alpha, const float32 *A, size_t lda,
+          const float32 *B, size_t ldb,
+          float32 beta, float32 *C, size_t ldc,
+          const GemmEpilogue *ep)
+{
+    if (M == 0 || N == 0) return;
+
+    if (K == 0 || alpha == 0.f)
+    {
+        if (beta != 1.f) GemmScaleC(M, N, beta, C, ldc);
+        if (ep) GemmApplyEpilogue(ep, C, ldc, 0, 0, M, N);
+        return;
+    }
+
+    if (M < GEMM_SMALL_ROWS || M * N * K <= GEMM_SMALL_VOLUME)
+    {
+        GemmSmall(opA, opB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc, ep);
+        return;
+    }
+
+    const GemmKernel *kernel = GemmSelectKernel();
+    GemmBuffers *buf = GemmGetBuffers();
+
+    // NOTE(liam): strides of op(A) and op(B) in (row, col) order.
+    size_t ars = (opA == Gemm_N) ? lda : 1;
+    size_t acs = (opA == Gemm_N) ? 1 : lda;
+    size_t brs = (opB == Gemm_N) ? ldb : 1;
+    size_t bcs = (opB == Gemm_N) ? 1 : ldb;
+
+    if (beta != 0.f && beta != 1.f)
+    {
+        GemmScaleC(M, N, beta, C, ldc);
+    }
+
+    for (size_t jc = 0; jc < N; jc += GEMM_NC)
+    {
+        size_t nc = Min(GEMM_NC, N - jc);
+
+        for (size_t pc = 0; pc < K; pc += GEMM_KC)
+        {
+            size_t kc = Min(GEMM_KC, K - pc);
+            bool32 accumulate = (pc > 0) || (beta != 0.f);
+            const GemmEpilogue *tileEp = (pc + kc == K) ? ep : NULL;
+
+            GemmPackB(kernel->nr, kc, nc, B + pc * brs + jc * bcs, brs, bcs, buf->b);
+
+            for (size_t ic = 0; ic < M; ic += GEMM_MC)
+            {
+                size_t mc = Min(GEMM_MC, M - ic);
+
+                GemmPackA(kernel->mr, mc, kc, alpha, A + ic * ars + pc * acs, ars, acs, buf->a);
+                GemmMacroKernel(kernel, mc, nc, kc, buf->a, buf->b,
+                                C + ic * ldc + jc, ldc, accumulate,
+                                tileEp, ic, jc);
+            }
+        }
+    }
+}
+
+// NOTE(liam): the packed layout is the sequence of blocks GemmF32Ex would
+// pack on the fly, in the same (jc, pc) order: every KC x NC block as NR
+// wide column panels. NC is a multiple of NR, so only the last column
+// panel carries padding.
+size_t
+GemmPackedBSize(size_t K, size_t N)
+{
+    uint32 nr = GemmSelectKernel()->nr;
+    return K * AlignPow2(N, nr);
+}
+
+void
+GemmPackBInto(GemmPackedB *pb, float32 *data, GemmOp opB, size_t K, size_t N,
+              const float32 *B, size_t ldb)
+{
+    const GemmKernel *kernel = GemmSelectKernel();
+    size_t brs = (opB == Gemm_N) ? ldb : 1;
+    size_t bcs = (opB == Gemm_N) ? 1 : ldb;
+
+    pb->K = K;
+    pb->N = N;
+    pb->nr = kernel->nr;
+    pb->data = data;
+
+    float32 *out = data;
+    for (size_t jc = 0; jc < N; jc += GEMM_NC)
+    {
+        size_t nc = Min(GEMM_NC, N - jc);
+        for (size_t pc = 0; pc < K; pc += GEMM_KC)
+        {
+            size_t kc = Min(GEMM_KC, K - pc);
+            GemmPackB(kernel->nr, kc, nc, B + pc * brs + jc * bcs, brs, bcs, out);
+            out += kc * AlignPow2(nc, kernel->nr);
+        }
+    }
+}
+
+// NOTE(liam): a few rows against packed panels: each panel row of NR
+// values is one contiguous axpy, so B is streamed once in storage order.
+static void
+GemmSmallPacked(GemmOp opA, size_t M, float32 alpha, const float32 *A, size_t lda,
+                const GemmPackedB *B, float32 beta, float32 *C, size_t ldc,
+                const GemmEpilogue *ep)
+{
+    const SimdKernels *simd = SimdGet();
+    size_t ars = (opA == Gemm_N) ? lda : 1;
+    size_t acs = (opA == Gemm_N) ? 1 : lda;
+    uint32 nr = B->nr;
+    _Alignas(64) float32 acc[GEMM_NR_MAX];
+
+    GemmScaleC(M, B->N, beta, C, ldc);
+
+    const float32 *pb = B->data;
+    for (size_t jc = 0; jc < B->N; jc += GEMM_NC)
+    {
+        size_t nc = Min(GEMM_NC, B->N - jc);
+        for (size_t pc = 0; pc < B->K; pc += GEMM_KC)
+        {
+            size_t kc = Min(GEMM_KC, B->K - pc);
+            for (size_t jr = 0; jr < nc; jr += nr)
+            {
+                size_t cols = Min(nr, nc - jr);
+                const float32 *panel = pb + jr * kc;
+
+                for (size_t i = 0; i < M; i++)
+                {
+                    const float32 *a = A + i * ars + pc * acs;
+                    simd->fill(acc, 0.f, nr);
+                    for (size_t k = 0; k < kc; k++)
+                    {
+                        simd->axpy(acc, a[k * acs], panel + k * nr, nr);
+                    }
+                    float32 *c = C + i * ldc + jc + jr;
+                    simd->axpy(c, alpha, acc, cols);
+                }
+            }
+            pb += kc * AlignPow2(nc, nr);
+        }
+    }
+
+    if (ep)
+    {
+        GemmApplyEpilogue(ep, C, ldc, 0, 0, M, B->N);
+    }
+}
+
+void
+GemmF32Packed(GemmOp opA, size_t M, float32 alpha, const float32 *A, size_t lda,
+              const GemmPackedB *B, float32 beta, float32 *C, size_t ldc,
+              const GemmEpilogue *ep)
+{
+    size_t N = B->N;
+    size_t K = B->K;
+    if (M == 0 || N == 0) return;
+
+    if (K == 0 || alpha == 0.f)
+    {
+        if (beta != 1.f) GemmScaleC(M, N, beta, C, ldc);
+        if (ep) GemmApplyEpilogue(ep, C, ldc, 0, 0, M, N);
+        return;
+    }
+
+    const GemmKernel *kernel = GemmSelectKernel();
+    Assert(kernel->nr == B->nr && "B was packed under a different simd level.");
+
+    if (M < GEMM_SMALL_ROWS)
+    {
+        GemmSmallPacked(opA, M, alpha, A, lda, B, beta, C, ldc, ep);
+        return;
+    }
+
+    GemmBuffers *buf = GemmGetBuffers();
+    size_t ars = (opA == Gemm_N) ? lda : 1;
+    size_t acs = (opA == Gemm_N) ? 1 : lda;
+
+    if (beta != 0.f && beta != 1.f)
+    {
+        GemmScaleC(M, N, beta, C, ldc);
+    }
+
+    const float32 *pb = B->data;
+    for (size_t jc = 0; jc < N; jc += GEMM_NC)
+    {
+        size_t nc = Min(GEMM_NC, N - jc);
+
+        for (size_t pc = 0; pc < K; pc += GEMM_KC)
+        {
+            size_t kc = Min(GEMM_KC, K - pc);
+            bool32 accumulate = (pc > 0) || (beta != 0.f);
+            const GemmEpilogue *tileEp = (pc + kc == K) ? ep : NULL;
+
+            for (size_t ic = 0; ic < M; ic += GEMM_MC)
+            {
+                size_t mc = Min(GEMM_MC, M - ic);
+
+                GemmPackA(kernel->mr, mc, kc, alpha, A + ic * ars + pc * acs, ars, acs, buf->a);
+                GemmMacroKernel(kernel, mc, nc, kc, buf->a, pb,
+                                C + ic * ldc + jc, ldc, accumulate,
+                                tileEp, ic, jc);
+            }
+            pb += kc * AlignPow2(nc, kernel->nr);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * ---------------
+ * Liam Bagabag
+ * Version: 1.0.0
+ * requires: n/a
+ * ---------------
+ */
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "def.h"
+
+typedef enum gemm_op {
+    Gemm_N, // operand used as stored
+    Gemm_T, // operand used transposed, read in place
+} GemmOp;
+
+// NOTE(liam): row-major single precision matrix multiply.
+//   C[M x N] = alpha * op(A)[M x K] * op(B)[K x N] + beta * C
+// with Gemm_T, A is stored K x M and B is stored N x K.
+// lda/ldb/ldc are the distances (in floats) between consecutive stored rows.
+// when beta is 0, C is write-only and may hold garbage on entry.
+// C must not alias A or B.
+void GemmF32(GemmOp opA, GemmOp opB, size_t M, size_t N, size_t K,
+             float32 alpha, const float32 *A, size_t lda,
+             const float32 *B, size_t ldb,
+             float32 beta, float32 *C, size_t ldc);
+
+// NOTE(liam): optional per-tile epilogue, applied once a tile of C holds
+// its final value and before it leaves cache:
+//   C += bias (broadcast over rows); Z = C; act(C row) in place.
+// any member may be NULL. act is called once per tile row, not per element.
+typedef struct gemm_epilogue {
+    const float32 *bias;
+    float32 *Z;
+    size_t ldz;
+    void (*act)(float32 *x, size_t n);
+} GemmEpilogue;
+
+void GemmF32Ex(GemmOp opA, GemmOp opB, size_t M, size_t N, size_t K,
+               float32 alpha, const float32 *A, size_t lda,
+               const float32 *B, size_t ldb,
+               float32 beta, float32 *C, size_t ldc,
+               const GemmEpilogue *ep);
+
+// NOTE(liam): op(B) packed once into the micro-kernel's panel layout, for
+// weights that are multiplied many times without changing (inference).
+// data is caller-owned, GemmPackedBSize floats, 64-byte aligned. a packed B
+// is tied to the kernel of the simd level it was packed under.
+typedef struct gemm_packed_b {
+    size_t K;
+    size_t N;
+    uint32 nr;
+    float32 *data;
+} GemmPackedB;
+
+size_t GemmPackedBSize(size_t K, size_t N);
+void GemmPackBInto(GemmPackedB *pb, float32 *data, GemmOp opB, size_t K, size_t N,
+                   const float32 *B, size_t ldb);
+
+// NOTE(liam): C[M x N] = alpha * op(A) . B + beta * C, with B prepacked.
+void GemmF32Packed(GemmOp opA, size_t M, float32 alpha, const float32 *A, size_t lda,
+                   const GemmPackedB *B, float32 beta, float32 *C, size_t ldc,
+                   const GemmEpilogue *ep);
+
+#endif //GEMM_H
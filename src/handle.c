@@ -0,0 +1,196 @@
+#include "handle.h"
+#include <string.h>
+
+bool32
+NeuralHandleInit(NeuralHandle *handle, uint32 readerCount, uint32 tileRows)
+{
+    *handle = (NeuralHandle){0};
+    handle->readerCount = Max(readerCount, 1);
+    handle->tileRows = tileRows;
+    // NOTE(liam): epoch 0 means "not reading", so counting starts at 1.
+    handle->epoch = 1;
+
+    if (posix_memalign((void **)&handle->readers, 64, handle->readerCount * sizeof(NeuralReaderSlot)) != 0)
+    {
+        handle->readers = NULL;
+        return false;
+    }
+    memset(handle->readers, 0, handle->readerCount * sizeof(NeuralReaderSlot));
+    pthread_mutex_init(&handle->writeLock, NULL);
+    return true;
+}
+
+static void
+NeuralSnapshotFree(NeuralSnapshot *snap)
+{
+    // NOTE(liam): the snapshot lives inside its own arena.
+    Arena arena = snap->arena;
+    ArenaFree(&arena);
+}
+
+void
+NeuralHandleDestroy(NeuralHandle *handle)
+{
+    NeuralSnapshot *current = __atomic_load_n(&handle->current, __ATOMIC_ACQUIRE);
+    if (current) NeuralSnapshotFree(current);
+
+    while (handle->retired)
+    {
+        NeuralSnapshot *next = handle->retired->retiredNext;
+        NeuralSnapshotFree(handle->retired);
+        handle->retired = next;
+    }
+
+    pthread_mutex_destroy(&handle->writeLock);
+    free(handle->readers);
+    *handle = (NeuralHandle){0};
+}
+
+static NeuralSnapshot *
+NeuralSnapshotBuild(NeuralHandle *handle, NeuralNet nn)
+{
+    // NOTE(liam): packed weights of a big layer land in one block of their
+    // own; huge pages keep GEMM's walks over them out of the TLB.
+    Arena arena = {0};
+    ArenaSetHugePages(&arena, ARENA_HUGE_PAGE_SIZE);
+    NeuralSnapshot *snap = PushStruct(&arena, NeuralSnapshot);
+    *snap = (NeuralSnapshot){0};
+
+    if (!NeuralModelInit(&arena, &snap->model, nn, handle->tileRows))
+    {
+        ArenaFree(&arena);
+        return NULL;
+    }
+
+    snap->scratch = PushArray(&arena, NeuralPlanScratch, handle->readerCount);
+    for (uint32 r = 0; r < handle->readerCount; r++)
+    {
+        NeuralModelScratchInit(&arena, &snap->model, snap->scratch + r);
+    }
+
+    snap->arena = arena;
+    return snap;
+}
+
+// NOTE(liam): the oldest epoch any reader is still inside, or UINT64_MAX
+// when nobody is reading.
+static uint64
+NeuralHandleOldestReader(NeuralHandle *handle)
+{
+    uint64 res = UINT64_MAX;
+    for (uint32 r = 0; r < handle->readerCount; r++)
+    {
+        uint64 e = __atomic_load_n(&handle->readers[r].epoch, __ATOMIC_SEQ_CST);
+        if (e) res = Min(res, e);
+    }
+    return res;
+}
+
+static uint32
+NeuralHandleReclaimLocked(NeuralHandle *handle)
+{
+    uint64 oldest = NeuralHandleOldestReader(handle);
+    uint32 waiting = 0;
+
+    // NOTE(liam): a snapshot retired when the epoch moved to E can only be
+    // held by readers that entered before E.
+    NeuralSnapshot **link = &handle->retired;
+    while (*link)
+    {
+        NeuralSnapshot *snap = *link;
+        if (snap->retiredEpoch <= oldest)
+        {
+            *link = snap->retiredNext;
+            NeuralSnapshotFree(snap);
+            handle->reclaimed++;
+        }
+        else
+        {
+            link = &snap->retiredNext;
+            waiting++;
+        }
+    }
+    return waiting;
+}
+
+static uint64
+NeuralHandlePublishSnapshot(NeuralHandle *handle, NeuralSnapshot *snap)
+{
+    pthread_mutex_lock(&handle->writeLock);
+
+    snap->version = ++handle->published;
+    NeuralSnapshot *old = __atomic_exchange_n(&handle->current, snap, __ATOMIC_SEQ_CST);
+    uint64 epoch = __atomic_add_fetch(&handle->epoch, 1, __ATOMIC_SEQ_CST);
+
+    if (old)
+    {
+        old->retiredEpoch = epoch;
+        old->retiredNext = handle->retired;
+        handle->retired = old;
+    }
+    NeuralHandleReclaimLocked(handle);
+
+    uint64 res = snap->version;
+    pthread_mutex_unlock(&handle->writeLock);
+    return res;
+}
+
+uint64
+NeuralHandlePublish(NeuralHandle *handle, NeuralNet nn)
+{
+    // NOTE(liam): all the packing happens here, before the lock; readers
+    // keep running on the old snapshot the whole time.
+    NeuralSnapshot *snap = NeuralSnapshotBuild(handle, nn);
+    return snap ? NeuralHandlePublishSnapshot(handle, snap) : 0;
+}
+
+uint64
+NeuralHandlePublishFile(NeuralHandle *handle, const char *path)
+{
+    Arena load = {0};
+    NeuralNet nn = {0};
+    uint64 res = 0;
+
+    if (NeuralNetLoadV2(&load, &nn, path, NeuralLoad_Map | NeuralLoad_Verify))
+    {
+        res = NeuralHandlePublish(handle, nn);
+        NeuralNetUnmap(&nn);
+    }
+
+    ArenaFree(&load);
+    return res;
+}
+
+uint32
+NeuralHandleReclaim(NeuralHandle *handle)
+{
+    pthread_mutex_lock(&handle->writeLock);
+    uint32 res = NeuralHandleReclaimLocked(handle);
+    pthread_mutex_unlock(&handle->writeLock);
+    return res;
+}
+
+NeuralSnapshot *
+NeuralHandleAcquire(NeuralHandle *handle, uint32 reader)
+{
+    Assert(reader < handle->readerCount && "reader id out of range");
+
+    // NOTE(liam): announce the epoch before loading the pointer. both are
+    // seq_cst, so a writer that swapped before this epoch was read will
+    // not free what we load, and one that swaps after sees us in its scan.
+    uint64 epoch = __atomic_load_n(&handle->epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&handle->readers[reader].epoch, epoch, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&handle->current, __ATOMIC_SEQ_CST);
+}
+
+void
+NeuralHandleRelease(NeuralHandle *handle, uint32 reader)
+{
+    __atomic_store_n(&handle->readers[reader].epoch, 0, __ATOMIC_RELEASE);
+}
+
+void
+NeuralSnapshotPredict(NeuralSnapshot *snap, uint32 reader, Matrix X, Matrix Y)
+{
+    NeuralModelPredict(&snap->model, snap->scratch[reader], X, Y);
+}
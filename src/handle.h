@@ -0,0 +1,79 @@
+/*
+ * ---------------
+ * Liam Bagabag
+ * Version: 1.0.0
+ * requires: network.h
+ * ---------------
+ */
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include "network.h"
+#include <pthread.h>
+
+// NOTE(liam): one published, immutable version of a model. it owns its
+// arena, and everything a reader touches lives inside it: the frozen plan
+// model (which holds its own copy of the weights) and one scratch per
+// reader.
+typedef struct neural_snapshot {
+    Arena arena;
+    NeuralModel model;
+    NeuralPlanScratch *scratch; // one per reader slot
+    uint64 version;
+
+    // NOTE(liam): writer-only, once the snapshot has been replaced.
+    struct neural_snapshot *retiredNext;
+    uint64 retiredEpoch;
+} NeuralSnapshot;
+
+// NOTE(liam): epoch a reader entered at, 0 while it holds nothing. padded
+// so readers never share a cache line.
+typedef struct neural_reader_slot {
+    uint64 epoch;
+    uint8 pad[64 - sizeof(uint64)];
+} NeuralReaderSlot;
+
+// NOTE(liam): epoch-based RCU over snapshots. readers never lock or wait:
+// an acquire is two stores and two loads. writers build a whole new
+// snapshot off to the side, publish it with one atomic exchange, and free
+// an old one only after every reader that could have seen it has left.
+// writers are serialized among themselves only.
+typedef struct NeuralHandle {
+    NeuralSnapshot *current;
+    uint64 epoch;
+
+    NeuralReaderSlot *readers;
+    uint32 readerCount;
+    uint32 tileRows;
+
+    pthread_mutex_t writeLock;
+    NeuralSnapshot *retired;
+    uint64 published;
+    uint64 reclaimed;
+} NeuralHandle;
+
+// NOTE(liam): readerCount fixes how many threads may read at once; reader
+// ids are [0, readerCount) and each one must be used by one thread at a
+// time. tileRows is passed on to NeuralModelInit (0 for cache-sized).
+bool32 NeuralHandleInit(NeuralHandle *handle, uint32 readerCount, uint32 tileRows);
+// NOTE(liam): frees every snapshot; no reader may be inside.
+void NeuralHandleDestroy(NeuralHandle *handle);
+
+// NOTE(liam): the new snapshot packs its own copy of nn's params, so the
+// caller may go on training nn right after.
+// returns the new version, or 0 on failure.
+uint64 NeuralHandlePublish(NeuralHandle *handle, NeuralNet nn);
+// NOTE(liam): maps a v2 model file and freezes it into a new snapshot;
+// the mapping is dropped once the weights are packed.
+uint64 NeuralHandlePublishFile(NeuralHandle *handle, const char *path);
+// NOTE(liam): frees retired snapshots no reader can still hold; publish
+// calls this too. returns how many are still waiting.
+uint32 NeuralHandleReclaim(NeuralHandle *handle);
+
+// NOTE(liam): the snapshot stays valid until the matching release.
+NeuralSnapshot *NeuralHandleAcquire(NeuralHandle *handle, uint32 reader);
+void NeuralHandleRelease(NeuralHandle *handle, uint32 reader);
+// NOTE(liam): Y[i] = net(X[i]) with the reader's own scratch.
+void NeuralSnapshotPredict(NeuralSnapshot *snap, uint32 reader, Matrix X, Matrix Y);
+
+#endif //HANDLE_H
@@ -2,7 +2,7 @@
  * ---------------
  * Liam Bagabag
  * Version: 2.0.0
- * dependencies: alloc.h (specific), random.h (specific)
+ * dependencies: alloc.h (specific), random.h (specific), gemm.h (specific), simd.h (specific)
  * requires: MATRIX_IMPLEMENTATION
  * ---------------
  */
@@ -15,6 +15,8 @@
 
 #include "arena.h"
 #include "random.h"
+#include "gemm.h"
+#include "simd.h"
 
 #ifndef m_alloc
 # include <stdlib.h>
@@ -23,19 +25,31 @@
 # define m_free free
 #endif
 
+// NOTE(liam): stride is the distance in floats between the starts of two
+// consecutive rows (the leading dimension). it is cols for a matrix that
+// owns its memory and larger for a view into a wider one, so row, column
+// and block slices share memory with their parent instead of copying.
 typedef struct Matrix {
     size_t rows;
     size_t cols;
+    size_t stride;
     float *V;
 } Matrix, Row;
 
-#define MatrixAT(m, i, j) ((m).V[(i) * m.cols + (j)])
+#define MatrixAT(m, i, j) ((m).V[(i) * (m).stride + (j)])
+#define MatrixIsContiguous(m) ((m).stride == (m).cols || (m).rows <= 1)
 #define RowAT(r, i) MatrixAT(r, 0, i)
 
 #define MatrixSafeAT(m, i, j) MatrixAT(m, ClampDown(i, m.rows - 1), ClampDown(j, m.cols - 1))
 #define RowSafeAT(r, i) MatrixAT(r, 0, ClampDown(i, r.cols - 1))
 
 Matrix MatrixAlloc(size_t, size_t, float*);
+Matrix MatrixView(size_t rows, size_t cols, size_t stride, float *V);
+// NOTE(liam): zero-copy views, [start, end) of the rows or columns, or a
+// rows x cols block at (row, col). writes go through to the parent.
+Matrix MatrixViewRows(Matrix, size_t start, size_t end);
+Matrix MatrixViewCols(Matrix, size_t start, size_t end);
+Matrix MatrixViewBlock(Matrix, size_t row, size_t col, size_t rows, size_t cols);
 
 #define MatrixArenaAlloc(arena, i, j) (MatrixAlloc((i), (j), PushArray(arena, float, (i) * (j))))
 #define RowArenaAlloc(arena, i) MatrixArenaAlloc(arena, 1, i)
@@ -56,6 +70,8 @@ Matrix MatrixCopy(Arena *, Matrix);
 
 void MatrixSliceRow_(Matrix, Matrix, size_t, size_t);
 Matrix MatrixSliceRow(Arena *, Matrix, size_t, size_t);
+// NOTE(liam): dst row i = src row rows[i], for every row of dst.
+void MatrixGatherRows(Matrix, Matrix, const uint32 *);
 
 Matrix MatrixReturnM_(Arena *, Matrix, Matrix, void (*)(Matrix, Matrix, Matrix));
 void MatrixAddM_(Matrix, Matrix, Matrix);
@@ -69,6 +85,20 @@ void MatrixMulM_(Matrix, Matrix, Matrix); // Hadamard Product
 void MatrixDot_(Matrix, Matrix, Matrix);
 Matrix MatrixDot(Arena *arena, Matrix a, Matrix b);
 
+// NOTE(liam): c = alpha * op(a) . op(b) + beta * c, where op() transposes
+// in place when the matching flag is set. no transposed copy is made.
+void MatrixGemm_(Matrix c, Matrix a, bool32 transA, Matrix b, bool32 transB, float32 alpha, float32 beta);
+#define MatrixDotTN_(c, a, b) MatrixGemm_(c, a, true, b, false, 1.f, 0.f) // c = a^T . b
+#define MatrixDotNT_(c, a, b) MatrixGemm_(c, a, false, b, true, 1.f, 0.f) // c = a . b^T
+
+Matrix MatrixDotTN(Arena *arena, Matrix a, Matrix b);
+Matrix MatrixDotNT(Arena *arena, Matrix a, Matrix b);
+
+// NOTE(liam): fused dense layer, a = act(x . w + b), in a single pass over
+// the output. z receives x . w + b if z.V is set and is skipped otherwise.
+// act works on a whole row in place and may be NULL (identity).
+void MatrixDense_(Matrix a, Matrix z, Matrix x, Matrix w, Row b, void (*act)(float32 *, size_t));
+
 Matrix MatrixReturnS_(Arena *, Matrix, float, void (*)(Matrix, Matrix, float));
 void MatrixAddS_(Matrix, Matrix, float);
 void MatrixSubS_(Matrix, Matrix, float);
@@ -104,11 +134,51 @@ MatrixAlloc(size_t rows, size_t cols, float* V)
 
     res.rows = rows;
     res.cols = cols;
+    res.stride = cols;
+    res.V = V;
+
+    return res;
+}
+
+Matrix
+MatrixView(size_t rows, size_t cols, size_t stride, float *V)
+{
+    Assert(stride >= cols);
+
+    Matrix res;
+
+    res.rows = rows;
+    res.cols = cols;
+    res.stride = stride;
     res.V = V;
 
     return res;
 }
 
+Matrix
+MatrixViewRows(Matrix a, size_t start, size_t end)
+{
+    Assert(start <= end && end <= a.rows);
+
+    return MatrixView(end - start, a.cols, a.stride, a.V + start * a.stride);
+}
+
+Matrix
+MatrixViewCols(Matrix a, size_t start, size_t end)
+{
+    Assert(start <= end && end <= a.cols);
+
+    return MatrixView(a.rows, end - start, a.stride, a.V + start);
+}
+
+Matrix
+MatrixViewBlock(Matrix a, size_t row, size_t col, size_t rows, size_t cols)
+{
+    Assert(row + rows <= a.rows && col + cols <= a.cols);
+
+    return MatrixView(rows, cols, a.stride, a.V + row * a.stride + col);
+}
+
 Matrix
 MatrixMalloc(size_t rows, size_t cols)
 {
@@ -116,6 +186,7 @@ MatrixMalloc(size_t rows, size_t cols)
 
     res.rows = rows;
     res.cols = cols;
+    res.stride = cols;
     res.V = (float*)m_alloc(sizeof(float) * rows * cols);
     Assert(!res.V && "Malloc failed during Matrix Allocation.");
 
@@ -152,6 +223,7 @@ MatrixRow(Matrix a, size_t row)
     return (Row) {
         .rows = 1,
         .cols = a.cols,
+        .stride = a.cols,
         .V = &MatrixAT(a, row, 0),
     };
 }
@@ -171,12 +243,13 @@ MatrixCopy_(Matrix b, Matrix a)
 {
     Assert(a.rows == b.rows);
     Assert(a.cols == b.cols);
-    for (size_t i = 0; i < b.rows; i++) {
-        for (size_t j = 0; j < b.cols; j++) {
-            MatrixAT(b, i, j) = MatrixAT(a, i, j);
-        }
-    }
 
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b))
+    {
+        SimdGet()->copy(b.V, a.V, a.rows * a.cols);
+        return;
+    }
+    for (size_t i = 0; i < a.rows; i++) SimdGet()->copy(&MatrixAT(b, i, 0), &MatrixAT(a, i, 0), a.cols);
 }
 
 Matrix
@@ -215,11 +288,12 @@ MatrixReturnS_(Arena *arena, Matrix a, float f, void (* mfn)(Matrix, Matrix, flo
 void
 MatrixFill(Matrix a, float x)
 {
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < a.cols; j++) {
-            MatrixAT(a, i, j) = x;
-        }
+    if (MatrixIsContiguous(a))
+    {
+        SimdGet()->fill(a.V, x, a.rows * a.cols);
+        return;
     }
+    for (size_t i = 0; i < a.rows; i++) SimdGet()->fill(&MatrixAT(a, i, 0), x, a.cols);
 }
 
 void
@@ -228,12 +302,12 @@ MatrixAddS_(Matrix b, Matrix a, float x)
     Assert(a.rows == b.rows);
     Assert(a.cols == b.cols);
 
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < a.cols; j++) {
-            /*b->V[i][j] = a->V[i][j] + x;*/
-            MatrixAT(b, i, j) = MatrixAT(a, i, j) + x;
-        }
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b))
+    {
+        SimdGet()->addS(b.V, a.V, x, a.rows * a.cols);
+        return;
     }
+    for (size_t i = 0; i < a.rows; i++) SimdGet()->addS(&MatrixAT(b, i, 0), &MatrixAT(a, i, 0), x, a.cols);
 }
 
 void
@@ -242,14 +316,14 @@ MatrixAddM_(Matrix c, Matrix a, Matrix b)
     Assert(a.rows == b.rows);
     Assert(a.cols == b.cols);
 
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < b.cols; j++) {
-            /*c->V[i][j] = a->V[i][j] + b->V[i][j];*/
-            /*c.V[i * c.cols + j] = a.V[i * a.cols + j] + b.V[i * b.cols
-             * + j];*/
-            MatrixAT(c, i, j) =
-                MatrixAT(a, i, j) + MatrixAT(b, i, j);
-        }
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b) && MatrixIsContiguous(c))
+    {
+        SimdGet()->add(c.V, a.V, b.V, a.rows * a.cols);
+        return;
+    }
+    for (size_t i = 0; i < a.rows; i++)
+    {
+        SimdGet()->add(&MatrixAT(c, i, 0), &MatrixAT(a, i, 0), &MatrixAT(b, i, 0), a.cols);
     }
 }
 
@@ -258,11 +332,13 @@ MatrixSum(Matrix b, Matrix a)
 {
     Assert(b.rows == a.rows);
     Assert(b.cols == a.cols);
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < b.cols; j++) {
-            MatrixAT(b, i, j) += MatrixAT(a, i, j);
-        }
+
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b))
+    {
+        SimdGet()->sum(b.V, a.V, a.rows * a.cols);
+        return;
     }
+    for (size_t i = 0; i < a.rows; i++) SimdGet()->sum(&MatrixAT(b, i, 0), &MatrixAT(a, i, 0), a.cols);
 }
 
 void
@@ -270,12 +346,13 @@ MatrixSubS_(Matrix b, Matrix a, float x)
 {
     Assert(a.rows == b.rows);
     Assert(a.cols == b.cols);
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < a.cols; j++) {
-            /*b->V[i][j] = a->V[i][j] + x;*/
-            MatrixAT(b, i, j) = MatrixAT(a, i, j) - x;
-        }
+
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b))
+    {
+        SimdGet()->subS(b.V, a.V, x, a.rows * a.cols);
+        return;
     }
+    for (size_t i = 0; i < a.rows; i++) SimdGet()->subS(&MatrixAT(b, i, 0), &MatrixAT(a, i, 0), x, a.cols);
 }
 
 void
@@ -284,11 +361,15 @@ MatrixSubM_(Matrix c, Matrix a, Matrix b)
     Assert(a.rows == b.rows);
     Assert(a.cols == b.cols);
     Assert(a.rows == c.rows);
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < b.cols; j++) {
-            /*c->V[i][j] = a->V[i][j] - b->V[i][j];*/
-            MatrixAT(c, i, j) = MatrixAT(a, i, j) - MatrixAT(b, i, j);
-        }
+
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b) && MatrixIsContiguous(c))
+    {
+        SimdGet()->sub(c.V, a.V, b.V, a.rows * a.cols);
+        return;
+    }
+    for (size_t i = 0; i < a.rows; i++)
+    {
+        SimdGet()->sub(&MatrixAT(c, i, 0), &MatrixAT(a, i, 0), &MatrixAT(b, i, 0), a.cols);
     }
 }
 
@@ -297,11 +378,13 @@ MatrixMulS_(Matrix b, Matrix a, float x)
 {
     Assert(a.rows == b.rows);
     Assert(a.cols == b.cols);
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < a.cols; j++) {
-            MatrixAT(b, i, j) = MatrixAT(a, i, j) * x;
-        }
+
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b))
+    {
+        SimdGet()->mulS(b.V, a.V, x, a.rows * a.cols);
+        return;
     }
+    for (size_t i = 0; i < a.rows; i++) SimdGet()->mulS(&MatrixAT(b, i, 0), &MatrixAT(a, i, 0), x, a.cols);
 }
 
 void
@@ -312,14 +395,10 @@ MatrixDot_(Matrix c, Matrix a, Matrix b)
     Assert(a.rows == c.rows);
     Assert(c.cols == b.cols);
 
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < b.cols; j++) {
-            MatrixAT(c, i, j) = 0;
-            for (size_t k = 0; k < b.rows; k++) {
-                MatrixAT(c, i, j) += MatrixAT(a, i, k) * MatrixAT(b, k, j);
-            }
-        }
-    }
+    GemmF32(Gemm_N, Gemm_N, a.rows, b.cols, a.cols,
+            1.f, a.V, a.stride,
+            b.V, b.stride,
+            0.f, c.V, c.stride);
 }
 
 Matrix
@@ -332,6 +411,64 @@ MatrixDot(Arena *arena, Matrix a, Matrix b)
     return result;
 }
 
+void
+MatrixGemm_(Matrix c, Matrix a, bool32 transA, Matrix b, bool32 transB, float32 alpha, float32 beta)
+{
+    size_t m = transA ? a.cols : a.rows;
+    size_t k = transA ? a.rows : a.cols;
+    size_t n = transB ? b.rows : b.cols;
+
+    Assert(k == (transB ? b.cols : b.rows));
+    Assert(c.rows == m);
+    Assert(c.cols == n);
+
+    GemmF32(transA ? Gemm_T : Gemm_N, transB ? Gemm_T : Gemm_N, m, n, k,
+            alpha, a.V, a.stride,
+            b.V, b.stride,
+            beta, c.V, c.stride);
+}
+
+void
+MatrixDense_(Matrix a, Matrix z, Matrix x, Matrix w, Row b, void (*act)(float32 *, size_t))
+{
+    Assert(x.cols == w.rows);
+    Assert(a.rows == x.rows);
+    Assert(a.cols == w.cols);
+    Assert(b.cols == w.cols);
+    Assert(!z.V || (z.rows == a.rows && z.cols == a.cols));
+
+    GemmEpilogue ep = {0};
+    ep.bias = b.V;
+    ep.Z = z.V;
+    ep.ldz = z.stride;
+    ep.act = act;
+
+    GemmF32Ex(Gemm_N, Gemm_N, x.rows, w.cols, x.cols,
+              1.f, x.V, x.stride,
+              w.V, w.stride,
+              0.f, a.V, a.stride, &ep);
+}
+
+Matrix
+MatrixDotTN(Arena *arena, Matrix a, Matrix b)
+{
+    Matrix result = MatrixArenaAlloc(arena, a.cols, b.cols);
+
+    MatrixDotTN_(result, a, b);
+
+    return result;
+}
+
+Matrix
+MatrixDotNT(Arena *arena, Matrix a, Matrix b)
+{
+    Matrix result = MatrixArenaAlloc(arena, a.rows, b.rows);
+
+    MatrixDotNT_(result, a, b);
+
+    return result;
+}
+
 void
 MatrixMulM_(Matrix c, Matrix a, Matrix b)
 {
@@ -340,10 +477,14 @@ MatrixMulM_(Matrix c, Matrix a, Matrix b)
     Assert(c.cols == a.cols);
     Assert(b.cols == a.cols);
 
-    for (size_t i = 0; i < a.rows; i++) {
-        for (size_t j = 0; j < b.cols; j++) {
-            MatrixAT(c, i, j) = MatrixAT(a, i, j) * MatrixAT(b, i, j);
-        }
+    if (MatrixIsContiguous(a) && MatrixIsContiguous(b) && MatrixIsContiguous(c))
+    {
+        SimdGet()->mul(c.V, a.V, b.V, a.rows * a.cols);
+        return;
+    }
+    for (size_t i = 0; i < a.rows; i++)
+    {
+        SimdGet()->mul(&MatrixAT(c, i, 0), &MatrixAT(a, i, 0), &MatrixAT(b, i, 0), a.cols);
     }
 }
 
@@ -352,7 +493,7 @@ MatrixApply(Matrix a, float (*fun)(float))
 {
     for (size_t i = 0; i < a.rows; i++) {
         for (size_t j = 0; j < a.cols; j++) {
-            a.V[i * a.cols + j] = (*fun)(a.V[i * a.cols + j]);
+            MatrixAT(a, i, j) = (*fun)(MatrixAT(a, i, j));
         }
     }
 }
@@ -540,10 +681,17 @@ MatrixSliceRow_(Matrix b, Matrix a, size_t start, size_t end)
     Assert(b.cols == a.cols);
     Assert(start != end);
 
-    for (size_t i = start; i < end; i++) {
-        for (size_t j = 0; j < a.cols; j++) {
-            MatrixAT(b, i - start, j) = MatrixAT(a, i, j);
-        }
+    MatrixCopy_(b, MatrixViewRows(a, start, end));
+}
+
+void
+MatrixGatherRows(Matrix dst, Matrix src, const uint32 *rows)
+{
+    Assert(dst.cols == src.cols);
+
+    for (size_t i = 0; i < dst.rows; i++) {
+        Assert(rows[i] < src.rows);
+        SimdGet()->copy(&MatrixAT(dst, i, 0), &MatrixAT(src, rows[i], 0), src.cols);
     }
 }
 
@@ -0,0 +1,169 @@
+#include "network.h"
+
+// NOTE(liam): steps of one training step, for L weight layers: forward
+// layer l runs at step l, backward layer l at step 2L - 1 - l. a buffer is
+// live over [first, last], both ends included, so a buffer read and one
+// written in the same step never share memory.
+static void
+NeuralMemoryLifetimes(NeuralMemoryPlan *plan, NeuralNet nn, uint32 batchSize)
+{
+    uint32 L = nn.layerCount - 1;
+    bool32 train = plan->mode == NeuralMemory_Train;
+    NeuralMemoryBuffer *buf = plan->buffers;
+
+    for (uint32 l = 0; l < L; l++)
+    {
+        size_t bytes = AlignPow2((size_t)batchSize * nn.layerSizes[l + 1] * sizeof(float32), 64);
+        if (train)
+        {
+            // NOTE(liam): Z[l] and A[l] feed layer l + 1 forward, then
+            // act'() and dW[l + 1] on the way back, last used at b_l.
+            *buf++ = (NeuralMemoryBuffer){ NeuralBuffer_Z, l, l, 2 * L - 1 - l, 0, bytes };
+            *buf++ = (NeuralMemoryBuffer){ NeuralBuffer_A, l, l, 2 * L - 1 - l, 0, bytes };
+            // NOTE(liam): delta[l] is written at b_l and read once more by
+            // b_(l - 1) to propagate the error down.
+            *buf++ = (NeuralMemoryBuffer){ NeuralBuffer_Delta, l, 2 * L - 1 - l, l ? 2 * L - l : 2 * L - 1, 0, bytes };
+        }
+        else
+        {
+            // NOTE(liam): A[l] only feeds layer l + 1; the output outlives
+            // the pass.
+            *buf++ = (NeuralMemoryBuffer){ NeuralBuffer_A, l, l, l + 1, 0, bytes };
+        }
+    }
+
+    if (train)
+    {
+        // NOTE(liam): gradients are read by the update after the step.
+        size_t flat = NeuralNetParamLayout(nn, NULL, NULL);
+        *buf++ = (NeuralMemoryBuffer){ NeuralBuffer_Grad, 0, 0, 2 * L, 0, AlignPow2(flat * sizeof(float32), 64) };
+    }
+    Assert(buf == plan->buffers + plan->bufferCount);
+}
+
+// NOTE(liam): greedy by size, like a register allocator over byte ranges:
+// biggest buffers first, each at the lowest offset where it does not
+// overlap any placed buffer that is live at the same time.
+static void
+NeuralMemoryAssign(NeuralMemoryPlan *plan)
+{
+    ArenaTemp tmp = ArenaGetScratch(NULL, 0);
+    uint32 n = plan->bufferCount;
+    uint32 *order = PushArray(tmp.arena, uint32, n);
+    uint32 *busy = PushArray(tmp.arena, uint32, n);
+
+    for (uint32 i = 0; i < n; i++)
+    {
+        uint32 j = i;
+        for (; j > 0 && plan->buffers[order[j - 1]].bytes < plan->buffers[i].bytes; j--) order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    plan->totalBytes = 0;
+    plan->naiveBytes = 0;
+    for (uint32 k = 0; k < n; k++)
+    {
+        NeuralMemoryBuffer *buf = plan->buffers + order[k];
+
+        // NOTE(liam): the placed buffers live alongside this one, by offset.
+        uint32 busyCount = 0;
+        for (uint32 p = 0; p < k; p++)
+        {
+            NeuralMemoryBuffer *other = plan->buffers + order[p];
+            if (other->first > buf->last || buf->first > other->last) continue;
+
+            uint32 j = busyCount++;
+            for (; j > 0 && plan->buffers[busy[j - 1]].offset > other->offset; j--) busy[j] = busy[j - 1];
+            busy[j] = order[p];
+        }
+
+        size_t offset = 0;
+        for (uint32 p = 0; p < busyCount; p++)
+        {
+            NeuralMemoryBuffer *other = plan->buffers + busy[p];
+            if (offset + buf->bytes <= other->offset) break;
+            offset = Max(offset, other->offset + other->bytes);
+        }
+
+        buf->offset = offset;
+        plan->totalBytes = Max(plan->totalBytes, offset + buf->bytes);
+        plan->naiveBytes += buf->bytes;
+    }
+
+    ArenaReleaseScratch(tmp);
+}
+
+bool32
+NeuralMemoryPlanBuild(Arena *arena, NeuralMemoryPlan *plan, NeuralNet nn, uint32 batchSize, NeuralMemoryMode mode)
+{
+    *plan = (NeuralMemoryPlan){0};
+    if (nn.layerCount < 2 || !batchSize)
+    {
+        return false;
+    }
+
+    uint32 L = nn.layerCount - 1;
+    plan->mode = mode;
+    plan->batchCapacity = batchSize;
+    plan->bufferCount = mode == NeuralMemory_Train ? 3 * L + 1 : L;
+    plan->buffers = PushArray(arena, NeuralMemoryBuffer, plan->bufferCount);
+
+    NeuralMemoryLifetimes(plan, nn, batchSize);
+    NeuralMemoryAssign(plan);
+    return true;
+}
+
+void
+NeuralWorkspaceInitPlanned(Arena *arena, NeuralWorkspace *ws, NeuralNet nn, const NeuralMemoryPlan *plan)
+{
+    Assert(plan->mode == NeuralMemory_Train && "a workspace needs a training plan");
+
+    uint32 L = nn.layerCount - 1;
+    uint32 rows = plan->batchCapacity;
+    ws->batchCapacity = rows;
+    ws->droppedRows = 0;
+    ws->fwd.Z = PushArray(arena, Matrix, L);
+    ws->fwd.A = PushArray(arena, Matrix, L);
+    ws->delta = PushArray(arena, Matrix, L);
+    ws->grad.dW = PushArray(arena, Matrix, L);
+    ws->grad.dB = PushArray(arena, Row, L);
+
+    uint8 *block = PushArrayAlign(arena, uint8, plan->totalBytes, 64);
+    for (uint32 i = 0; i < plan->bufferCount; i++)
+    {
+        const NeuralMemoryBuffer *buf = plan->buffers + i;
+        float32 *at = (float32 *)(block + buf->offset);
+        Matrix m = MatrixAlloc(rows, nn.layerSizes[buf->layer + 1], at);
+
+        switch (buf->kind)
+        {
+            case NeuralBuffer_Z: ws->fwd.Z[buf->layer] = m; break;
+            case NeuralBuffer_A: ws->fwd.A[buf->layer] = m; break;
+            case NeuralBuffer_Delta: ws->delta[buf->layer] = m; break;
+            case NeuralBuffer_Grad:
+            {
+                ws->grad.flat = at;
+                ws->grad.flatCount = NeuralNetParamLayout(nn, NULL, NULL);
+                ZeroArray(ws->grad.flatCount, ws->grad.flat);
+                NeuralNetParamViews(nn, ws->grad.flat, ws->grad.dW, ws->grad.dB);
+            } break;
+        }
+    }
+}
+
+void
+NeuralInferenceInitPlanned(Arena *arena, NeuralForward *nh, NeuralNet nn, const NeuralMemoryPlan *plan)
+{
+    Assert(plan->mode == NeuralMemory_Inference && "an inference helper needs an inference plan");
+
+    nh->Z = NULL;
+    nh->A = PushArray(arena, Matrix, nn.layerCount - 1);
+
+    uint8 *block = PushArrayAlign(arena, uint8, plan->totalBytes, 64);
+    for (uint32 i = 0; i < plan->bufferCount; i++)
+    {
+        const NeuralMemoryBuffer *buf = plan->buffers + i;
+        nh->A[buf->layer] = MatrixAlloc(plan->batchCapacity, nn.layerSizes[buf->layer + 1],
+                                        (float32 *)(block + buf->offset));
+    }
+}
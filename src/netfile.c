@@ -0,0 +1,323 @@
+#include "network.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define NEURAL_FNV_OFFSET 0xcbf29ce484222325ull
+#define NEURAL_FNV_PRIME  0x100000001b3ull
+
+uint64
+NeuralNetChecksum(const float32 *params, size_t count)
+{
+    // NOTE(liam): the flat buffer is padded to 16 floats per tensor, so
+    // whole 64-bit words cover it; any odd tail is folded in on its own.
+    uint64 res = NEURAL_FNV_OFFSET;
+    const uint8 *p = (const uint8 *)params;
+    size_t bytes = count * sizeof(float32);
+    size_t i = 0;
+
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64 word;
+        memcpy(&word, p + i, sizeof(word));
+        res = (res ^ word) * NEURAL_FNV_PRIME;
+    }
+    for (; i < bytes; i++)
+    {
+        res = (res ^ p[i]) * NEURAL_FNV_PRIME;
+    }
+
+    return res;
+}
+
+static bool32
+NeuralWriteAll(int fd, const void *data, size_t size)
+{
+    const uint8 *p = data;
+    while (size)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool32
+NeuralReadAll(int fd, void *data, size_t size, off_t offset)
+{
+    uint8 *p = data;
+    while (size)
+    {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+bool32
+NeuralNetSaveV2(NeuralNet nn, const char *path)
+{
+    if (!nn.params || nn.layerCount < 2)
+    {
+        fprintf(stderr, "save failed! %s has no flat parameter buffer.\n", path);
+        return false;
+    }
+
+    NeuralFileHeader header = {0};
+    header.magic = NEURAL_FILE_MAGIC;
+    header.version = NEURAL_FILE_VERSION;
+    header.headerSize = sizeof(NeuralFileHeader);
+    header.layerCount = nn.layerCount;
+    header.dtype = NeuralDType_F32;
+    header.activation = nn.activation;
+    header.outputActivation = nn.outputActivation;
+    header.accuracy = nn.accuracy;
+    header.tableOffset = sizeof(NeuralFileHeader);
+    header.dataOffset = AlignPow2(header.tableOffset + nn.layerCount * sizeof(uint32), 64);
+    header.dataSize = nn.paramCount * sizeof(float32);
+    header.checksum = NeuralNetChecksum(nn.params, nn.paramCount);
+
+    char tmpPath[4096];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath))
+    {
+        return false;
+    }
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    uint8 pad[64] = {0};
+    size_t padSize = header.dataOffset - header.tableOffset - nn.layerCount * sizeof(uint32);
+
+    bool32 result = NeuralWriteAll(fd, &header, sizeof(header)) &&
+                    NeuralWriteAll(fd, nn.layerSizes, nn.layerCount * sizeof(uint32)) &&
+                    NeuralWriteAll(fd, pad, padSize) &&
+                    NeuralWriteAll(fd, nn.params, header.dataSize);
+    result = (close(fd) == 0) && result;
+
+    if (result)
+    {
+        result = rename(tmpPath, path) == 0;
+    }
+    if (!result)
+    {
+        fprintf(stderr, "write failed! could not save %s.\n", path);
+        unlink(tmpPath);
+    }
+
+    return result;
+}
+
+static bool32
+NeuralHeaderValid(NeuralFileHeader *header, uint64 fileSize)
+{
+    return header->magic == NEURAL_FILE_MAGIC &&
+           header->version == NEURAL_FILE_VERSION &&
+           header->headerSize == sizeof(NeuralFileHeader) &&
+           header->dtype == NeuralDType_F32 &&
+           header->layerCount >= 2 &&
+           header->activation < Activation_Count &&
+           header->outputActivation < Activation_Count &&
+           header->accuracy < ActivationAccuracy_Count &&
+           (header->dataOffset & 63) == 0 &&
+           // NOTE(liam): every bound by subtraction, so a crafted offset
+           // cannot wrap a sum back under the file size.
+           header->tableOffset >= sizeof(NeuralFileHeader) &&
+           header->dataOffset >= header->tableOffset &&
+           header->dataOffset - header->tableOffset >= (uint64)header->layerCount * sizeof(uint32) &&
+           header->dataOffset <= fileSize &&
+           header->dataSize <= fileSize - header->dataOffset;
+}
+
+// NOTE(liam): NeuralNetParamLayout for a layer table read from a file:
+// the same padded layout, in 64 bits, false as soon as a product, a padded
+// tensor or the running total would wrap.
+static bool32
+NeuralParamCountChecked(const uint32 *layerSizes, uint32 layerCount, uint64 *count)
+{
+    uint64 res = 0;
+    for (uint32 l = 0; l + 1 < layerCount; l++)
+    {
+        uint64 w;
+        uint64 tensors[2];
+        if (__builtin_mul_overflow((uint64)layerSizes[l], (uint64)layerSizes[l + 1], &w)) return false;
+        tensors[0] = w;
+        tensors[1] = layerSizes[l + 1];
+        for (uint32 t = 0; t < 2; t++)
+        {
+            if (__builtin_add_overflow(res, tensors[t], &res) ||
+                __builtin_add_overflow(res, 15, &res)) return false;
+            res &= ~(uint64)15;
+        }
+    }
+    *count = res;
+    return true;
+}
+
+bool32
+NeuralNetLoadV2(Arena *arena, NeuralNet *nn, const char *path, uint32 flags)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool32 result = false;
+    struct stat st;
+    NeuralFileHeader header = {0};
+
+    if (fstat(fd, &st) != 0 ||
+        !NeuralReadAll(fd, &header, sizeof(header), 0) ||
+        !NeuralHeaderValid(&header, (uint64)st.st_size))
+    {
+        fprintf(stderr, "load failed! %s is not a v%d model file.\n", path, NEURAL_FILE_VERSION);
+        goto done;
+    }
+
+    NeuralNet res = {0};
+    res.layerCount = header.layerCount;
+    res.layerCapacity = header.layerCount;
+    res.layerSizes = PushArray(arena, uint32, header.layerCount);
+    res.activation = (ActivationKind)header.activation;
+    res.outputActivation = (ActivationKind)header.outputActivation;
+    res.accuracy = (ActivationAccuracy)header.accuracy;
+
+    if (!NeuralReadAll(fd, res.layerSizes, header.layerCount * sizeof(uint32), header.tableOffset))
+    {
+        goto done;
+    }
+    for (uint32 l = 0; l < res.layerCount; l++)
+    {
+        if (!res.layerSizes[l]) goto done;
+    }
+    // NOTE(liam): compared in floats, so a table whose byte size wraps to
+    // dataSize cannot match.
+    uint64 paramCount = 0;
+    if (header.dataSize % sizeof(float32) != 0 ||
+        !NeuralParamCountChecked(res.layerSizes, res.layerCount, &paramCount) ||
+        paramCount != header.dataSize / sizeof(float32))
+    {
+        fprintf(stderr, "load failed! %s layer table does not match its data.\n", path);
+        goto done;
+    }
+
+    if (flags & NeuralLoad_Map)
+    {
+        // NOTE(liam): pages fault in as layers first touch them; nothing is
+        // read up front unless a checksum is asked for.
+        int share = (flags & NeuralLoad_Shared) ? MAP_SHARED : MAP_PRIVATE;
+        void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, share, fd, 0);
+        if (base == MAP_FAILED)
+        {
+            goto done;
+        }
+
+        res.mapping = base;
+        res.mappingSize = (size_t)st.st_size;
+        res.paramCount = header.dataSize / sizeof(float32);
+        res.params = (float32 *)((uint8 *)base + header.dataOffset);
+        res.W = PushArray(arena, Matrix, res.layerCount - 1);
+        res.B = PushArray(arena, Row, res.layerCount - 1);
+        NeuralNetParamViews(res, res.params, res.W, res.B);
+    }
+    else
+    {
+        NeuralNetAllocParams(arena, &res);
+        if (!NeuralReadAll(fd, res.params, header.dataSize, header.dataOffset))
+        {
+            goto done;
+        }
+        flags |= NeuralLoad_Verify;
+    }
+
+    if ((flags & NeuralLoad_Verify) && NeuralNetChecksum(res.params, res.paramCount) != header.checksum)
+    {
+        fprintf(stderr, "load failed! %s checksum mismatch.\n", path);
+        NeuralNetUnmap(&res);
+        goto done;
+    }
+
+    *nn = res;
+    result = true;
+
+done:
+    close(fd);
+    return result;
+}
+
+void
+NeuralNetUnmap(NeuralNet *nn)
+{
+    if (nn->mapping)
+    {
+        munmap(nn->mapping, nn->mappingSize);
+        nn->mapping = NULL;
+        nn->mappingSize = 0;
+        nn->params = NULL;
+        nn->W = NULL;
+        nn->B = NULL;
+    }
+}
+
+bool32
+NeuralInferenceOpen(Arena *arena, NeuralInference *inf, const char *path, uint32 batchCapacity)
+{
+    *inf = (NeuralInference){0};
+    if (!NeuralNetLoadV2(arena, &inf->nn, path, NeuralLoad_Map | NeuralLoad_Shared))
+    {
+        return false;
+    }
+
+    inf->batchCapacity = Max(batchCapacity, 1);
+    NeuralInferenceInitBatch(arena, &inf->scratch, inf->nn, inf->batchCapacity);
+    return true;
+}
+
+Matrix
+NeuralInferenceRun(NeuralInference *inf, Matrix x)
+{
+    Assert(x.rows <= inf->batchCapacity);
+
+    // NOTE(liam): the scratch rows are contiguous, so a smaller batch
+    // runs on a view of the first x.rows rows.
+    NeuralForward nh = inf->scratch;
+    Matrix A[inf->nn.layerCount - 1];
+    for (uint32 l = 0; l < inf->nn.layerCount - 1; l++)
+    {
+        A[l] = inf->scratch.A[l];
+        A[l].rows = x.rows;
+    }
+    nh.A = A;
+
+    NeuralNetForward(&nh, inf->nn, x);
+    return A[inf->nn.layerCount - 2];
+}
+
+void
+NeuralInferenceClose(NeuralInference *inf)
+{
+    NeuralNetUnmap(&inf->nn);
+    *inf = (NeuralInference){0};
+}
+
+size_t
+NeuralInferenceScratchBytes(NeuralInference *inf)
+{
+    size_t res = 0;
+    for (uint32 l = 0; l < inf->nn.layerCount - 1; l++)
+    {
+        res += inf->scratch.A[l].rows * inf->scratch.A[l].cols * sizeof(float32);
+    }
+    return res;
+}
@@ -35,6 +35,56 @@ uint32 NeuralNetIndexSafe(NeuralNet nn, uint32 layerNum, uint32 index)
     return ClampDown(limit, index);
 }
 
+size_t NeuralNetParamLayout(NeuralNet nn, size_t *wOffsets, size_t *bOffsets)
+{
+    size_t res = 0;
+    for (uint32 l = 0; l < nn.layerCount - 1; l++)
+    {
+        if (wOffsets) wOffsets[l] = res;
+        res = AlignPow2(res + (size_t)nn.layerSizes[l] * nn.layerSizes[l + 1], 16);
+
+        if (bOffsets) bOffsets[l] = res;
+        res = AlignPow2(res + nn.layerSizes[l + 1], 16);
+    }
+    return res;
+}
+
+void NeuralNetParamViews(NeuralNet nn, float32 *base, Matrix *W, Row *B)
+{
+    size_t offset = 0;
+    for (uint32 l = 0; l < nn.layerCount - 1; l++)
+    {
+        W[l] = MatrixAlloc(nn.layerSizes[l], nn.layerSizes[l + 1], base + offset);
+        offset = AlignPow2(offset + (size_t)nn.layerSizes[l] * nn.layerSizes[l + 1], 16);
+
+        B[l] = MatrixAlloc(1, nn.layerSizes[l + 1], base + offset);
+        offset = AlignPow2(offset + nn.layerSizes[l + 1], 16);
+    }
+}
+
+// NOTE(liam): one zeroed, 64-byte aligned buffer with W and B as views.
+void NeuralNetAllocParams(Arena *arena, NeuralNet *nn)
+{
+    nn->W = PushArray(arena, Matrix, nn->layerCount - 1);
+    nn->B = PushArray(arena, Row, nn->layerCount - 1);
+
+    nn->paramCount = NeuralNetParamLayout(*nn, NULL, NULL);
+    nn->params = PushArrayAlign(arena, float32, nn->paramCount, 64);
+    ZeroArray(nn->paramCount, nn->params);
+
+    NeuralNetParamViews(*nn, nn->params, nn->W, nn->B);
+}
+
+void NeuralBackZero(NeuralBack grad)
+{
+    SimdGet()->fill(grad.flat, 0.f, grad.flatCount);
+}
+
+float32 NeuralBackNorm(NeuralBack grad)
+{
+    return sqrtf(SimdGet()->dot(grad.flat, grad.flat, grad.flatCount));
+}
+
 bool32 NeuralNetSave(NeuralNet nn, char *path)
 {
     // saves the neural network to a csv-like file
@@ -89,11 +139,9 @@ bool32 NeuralNetLoad(Arena *arena, NeuralNet *nn, char *path, uint32 *layerSizes
         size_t expected = 0;
         size_t read = 0;
 
-        Matrix *W = PushArray(arena, Matrix, nn->layerCount - 1);
-        Row *B = PushArray(arena, Row, nn->layerCount - 1);
-
-        nn->W = W;
-        nn->B = B;
+        NeuralNetAllocParams(arena, nn);
+        Matrix *W = nn->W;
+        Row *B = nn->B;
 
         /*for (uint32 l = 0; l < nn->layerCount - 1; l++)*/
         /*{*/
@@ -103,8 +151,6 @@ bool32 NeuralNetLoad(Arena *arena, NeuralNet *nn, char *path, uint32 *layerSizes
         for (uint32 l = 0; l < nn->layerCount - 1; l++)
         {
             printf("value at %d is: %d x %d\n", l, nn->layerSizes[l], nn->layerSizes[l+1]);
-            nn->W[l] = MatrixArenaAlloc(arena, nn->layerSizes[l], nn->layerSizes[l + 1]);
-            nn->B[l] = RowArenaAlloc(arena, nn->layerSizes[l + 1]);
 
             read += fread(W[l].V, sizeof(float32), nn->layerSizes[l] * nn->layerSizes[l + 1], fp);
             read += fread(B[l].V, sizeof(float32), nn->layerSizes[l + 1], fp);
@@ -184,17 +230,10 @@ void NeuralNetCompile(Arena* arena, RandomSeries *series, NeuralNet *nn, uint32
     }
     Assert(nn->layerCount > 1 && "Network must have at least two layers.");
 
-    Matrix *W = PushArray(arena, Matrix, nn->layerCount - 1);
-    Row *B = PushArray(arena, Row, nn->layerCount - 1);
-
-    nn->W = W;
-    nn->B = B;
+    NeuralNetAllocParams(arena, nn);
 
     for (uint32 l = 0; l < nn->layerCount - 1; l++)
     {
-        nn->W[l] = MatrixArenaAlloc(arena, nn->layerSizes[l], nn->layerSizes[l + 1]);
-        nn->B[l] = RowArenaAlloc(arena, nn->layerSizes[l + 1]);
-
         if (randomize_params)
         {
             MatrixRandomize(series, nn->W[l], -1.f, 1.f);
@@ -205,68 +244,155 @@ void NeuralNetCompile(Arena* arena, RandomSeries *series, NeuralNet *nn, uint32
 
 void NeuralHelperInit(Arena *arena, NeuralForward *nh, NeuralNet nn)
 {
-    nh->Z = PushArray(arena, Row, nn.layerCount - 1);
-    nh->A = PushArray(arena, Row, nn.layerCount - 1);
+    NeuralHelperInitBatch(arena, nh, nn, 1);
+}
+
+void NeuralHelperInitBatch(Arena *arena, NeuralForward *nh, NeuralNet nn, uint32 batchSize)
+{
+    nh->Z = PushArray(arena, Matrix, nn.layerCount - 1);
+    nh->A = PushArray(arena, Matrix, nn.layerCount - 1);
 
     for (uint32 l = 0; l < nn.layerCount - 1; l++)
     {
-        nh->Z[l] = RowArenaAlloc(arena, nn.layerSizes[l + 1]);
-        nh->A[l] = RowArenaAlloc(arena, nn.layerSizes[l + 1]);
+        nh->Z[l] = MatrixArenaAlloc(arena, batchSize, nn.layerSizes[l + 1]);
+        nh->A[l] = MatrixArenaAlloc(arena, batchSize, nn.layerSizes[l + 1]);
     }
 }
 
-void NeuralNetForward(NeuralForward *nh, NeuralNet nn, Row x)
+void NeuralWorkspaceInit(Arena *arena, NeuralWorkspace *ws, NeuralNet nn, uint32 batchSize)
 {
-    // NOTE(liam): a[l] = w * a[l-1] + b; a[0] = x
-    Row *Z = nh->Z;
-    Row *A = nh->A;
-
-    // NOTE(liam): a[1] = z; z = w * a[0] + b
-    MatrixDot_(Z[0], x, nn.W[0]);
-    MatrixAddM_(Z[0], Z[0], nn.B[0]);
-    MatrixCopy_(A[0], Z[0]);
-    MatrixApply(A[0], sigmoidf);
+    // NOTE(liam): Z, A, delta and the gradients share one block laid out by
+    // the memory planner, so a workspace costs its peak and no more.
+    NeuralMemoryPlan plan;
+    ArenaTemp tmp = ArenaGetScratch(&arena, 1);
+    NeuralMemoryPlanBuild(tmp.arena, &plan, nn, Max(batchSize, 1), NeuralMemory_Train);
+    NeuralWorkspaceInitPlanned(arena, ws, nn, &plan);
+    ArenaReleaseScratch(tmp);
+}
 
-    for (uint32 l = 1; l < nn.layerCount - 1; l++)
+// NOTE(liam): buffers are row-major with a fixed column count, so the
+// first n rows are a view of the same memory.
+static void
+NeuralWorkspaceSetBatch(NeuralWorkspace *ws, NeuralNet nn, uint32 n)
+{
+    Assert(n <= ws->batchCapacity);
+    for (uint32 l = 0; l < nn.layerCount - 1; l++)
     {
-        MatrixDot_(Z[l], A[l-1], nn.W[l]);
-        MatrixAddM_(Z[l], Z[l], nn.B[l]);
-        MatrixCopy_(A[l], Z[l]);
-        MatrixApply(A[l], sigmoidf);
+        ws->fwd.Z[l].rows = n;
+        ws->fwd.A[l].rows = n;
+        ws->delta[l].rows = n;
     }
 }
 
-// uses sgd
-NeuralBack NeuralNetBackprop(Arena *arena, NeuralNet nn, Row x, Row y)
+void NeuralInferenceInit(Arena *arena, NeuralForward *nh, NeuralNet nn)
 {
-    NeuralForward nh = {0};
-    NeuralHelperInit(arena, &nh, nn);
+    NeuralInferenceInitBatch(arena, nh, nn, 1);
+}
 
-    NeuralBack nb = {0};
+void NeuralInferenceInitBatch(Arena *arena, NeuralForward *nh, NeuralNet nn, uint32 batchSize)
+{
+    nh->Z = NULL;
+    nh->A = PushArray(arena, Matrix, nn.layerCount - 1);
 
-    nb.dW = PushArray(arena, Matrix, nn.layerCount - 1);
-    nb.dB = PushArray(arena, Row, nn.layerCount - 1);
+    for (uint32 l = 0; l < nn.layerCount - 1; l++)
+    {
+        nh->A[l] = MatrixArenaAlloc(arena, batchSize, nn.layerSizes[l + 1]);
+    }
+}
 
-    Matrix *dW = nb.dW;
-    Matrix *dB = nb.dB;
+ActivationKind NeuralNetLayerActivation(NeuralNet nn, uint32 layer)
+{
+    return layer == nn.layerCount - 2 ? nn.outputActivation : nn.activation;
+}
+
+void NeuralNetForward(NeuralForward *nh, NeuralNet nn, Row x)
+{
+    // NOTE(liam): a[l] = act(a[l-1] * w + b); a[-1] = x
+    // x may hold a whole batch, one example per row, as long as nh was
+    // sized for it; every layer is then a single [B x in] . [in x out] GEMM.
+    // bias and activation are applied by the GEMM epilogue, and z is only
+    // written when the helper carries it (training). softmax needs the
+    // whole row, so it runs after the GEMM instead of per tile.
+    Row none = {0};
 
     for (uint32 l = 0; l < nn.layerCount - 1; l++)
     {
-        dW[l] = MatrixArenaAlloc(arena, nn.layerSizes[l], nn.layerSizes[l + 1]);
-        dB[l] = RowArenaAlloc(arena, nn.layerSizes[l + 1]);
+        Row in = l ? nh->A[l - 1] : x;
+        ActivationKind kind = NeuralNetLayerActivation(nn, l);
+        bool32 fused = ActivationIsElementwise(kind);
+
+        MatrixDense_(nh->A[l], nh->Z ? nh->Z[l] : none, in, nn.W[l], nn.B[l],
+                     fused ? ActivationGetRow(kind, nn.accuracy) : NULL);
+        if (!fused)
+        {
+            ActivationApply(kind, nn.accuracy, nh->A[l].V, nh->A[l].rows, nh->A[l].cols, nh->A[l].stride);
+        }
+    }
+}
+
+// uses sgd
+NeuralBack NeuralNetBackprop(Arena *arena, NeuralNet nn, Matrix x, Matrix y)
+{
+    NeuralWorkspace ws = {0};
+    NeuralWorkspaceInit(arena, &ws, nn, x.rows);
+    NeuralNetBackpropInto(&ws, nn, x, y);
+
+    return ws.grad;
+}
+
+// NOTE(liam): the dot of a row with itself is NaN or inf as soon as one
+// entry is, and d - d is 0 only for a finite d.
+static bool32
+NeuralRowFinite(const float32 *row, size_t n)
+{
+    float32 d = SimdGet()->dot(row, row, n);
+    return d - d == 0.f;
+}
 
-        MatrixFill(dW[l], 0.0f);
-        MatrixFill(dB[l], 0.0f);
+// NOTE(liam): dW = in^T . delta. once rows were dropped, in may be the
+// caller's x, which cannot be zeroed, so its non-finite rows are stepped
+// around (their delta is already zero; 0 * NaN is not).
+static void
+NeuralGradW(Matrix dW, Matrix in, Matrix delta, bool32 skipBadRows)
+{
+    if (!skipBadRows)
+    {
+        MatrixDotTN_(dW, in, delta);
+        return;
     }
 
+    float32 beta = 0.f;
+    size_t start = 0;
+    for (size_t i = 0; i <= in.rows; i++)
+    {
+        if (i < in.rows && NeuralRowFinite(&MatrixAT(in, i, 0), in.cols)) continue;
+        if (i > start)
+        {
+            MatrixGemm_(dW, MatrixViewRows(in, start, i), true, MatrixViewRows(delta, start, i), false, 1.f, beta);
+            beta = 1.f;
+        }
+        start = i + 1;
+    }
+    if (beta == 0.f) MatrixFill(dW, 0.f);
+}
+
+void NeuralNetBackpropInto(NeuralWorkspace *ws, NeuralNet nn, Matrix x, Matrix y)
+{
+    Assert(x.rows == y.rows);
+    NeuralWorkspaceSetBatch(ws, nn, x.rows);
+
+    NeuralForward nh = ws->fwd;
+    Matrix *dW = ws->grad.dW;
+    Matrix *dB = ws->grad.dB;
+
     NeuralNetForward(&nh, nn, x); // populates nh with A and Z
 
-    // per SGD, only 1 example, with 1 output example.
-    // input size: matrix of size (n examples) x (m data)
-    // output size: row of size 1 to n; 1 for binary classification, and more
-    // for non-binary
+    // NOTE(liam): the whole batch goes through at once. every row of x is
+    // one example, so A, Z and delta are [batch x layer size] and each
+    // layer's gradient is a single GEMM that also sums over the batch.
+    // output size: 1 column for binary classification, more for non-binary.
 
-    // NOTE(liam): delta = (A[-1] - y) * dsigmoidf(Z[-1])
+    // NOTE(liam): delta = (A[-1] - y) * act'(Z[-1])
     uint32 pos = nn.layerCount - 2;
 
 
@@ -274,65 +400,87 @@ NeuralBack NeuralNetBackprop(Arena *arena, NeuralNet nn, Row x, Row y)
     // TODO(liam): likely fix the cost function application
 
     // MSE Loss
-    Row dZ = MatrixCopy(arena, nh.Z[pos]);
-    MatrixApply(dZ, dsigmoidf);
-
-    Row error = MatrixSubM(arena, nh.A[pos], y);
-    MatrixMulS_(error, error, 2.0f);
-    Row delta = MatrixMulM(arena, error, dZ);
+    // NOTE(liam): the derivative comes from the stored activation (and z
+    // where needed) instead of re-evaluating the activation.
+    Matrix delta = ws->delta[pos];
+    MatrixSubM_(delta, nh.A[pos], y);
+    MatrixMulS_(delta, delta, 2.0f);
+    ActivationBackward(nn.outputActivation, nh.Z[pos].V, nh.A[pos].V, delta.V, delta.rows, delta.cols);
 
     /*MatrixPrint_(delta, "cost");*/
 
-    bool32 can_descend = true;
-    if (isnan(RowAT(delta, 0)))
-    {
-        fprintf(stderr, "ERROR: NaN value detected in loss.\n");
-        can_descend = false;
-    }
-    else if (RowAT(delta, 0) == 0.f)
+    // NOTE(liam): a row whose loss is not finite is dropped from the batch:
+    // its delta and its hidden activations are zeroed, so it adds nothing to
+    // any gradient. rows are judged one at a time, so splitting a batch into
+    // shards never changes which rows survive. a zero loss needs no special
+    // case; its gradient is zero.
+    uint32 dropped = 0;
+    for (size_t i = 0; i < delta.rows; i++)
     {
-        fprintf(stderr, "WARNING: Network is not learning (aka. achieving 0 loss).\n");
-        can_descend = false;
+        if (NeuralRowFinite(&MatrixAT(delta, i, 0), delta.cols)) continue;
+
+        dropped++;
+        SimdGet()->fill(&MatrixAT(delta, i, 0), 0.f, delta.cols);
+        for (uint32 l = 0; l < pos; l++)
+        {
+            SimdGet()->fill(&MatrixAT(nh.Z[l], i, 0), 0.f, nh.Z[l].cols);
+            SimdGet()->fill(&MatrixAT(nh.A[l], i, 0), 0.f, nh.A[l].cols);
+        }
     }
+    ws->droppedRows += dropped;
 
-    if (can_descend)
-    {
-        MatrixCopy_(dB[pos], delta);
+    // NOTE(liam): dB = column sums of delta, dW = input^T . delta with
+    // the input read transposed in place (beta = 0 overwrites dW).
+    MatrixFill(dB[pos], 0.0f);
+    for (size_t i = 0; i < delta.rows; i++) MatrixSum(dB[pos], MatrixRow(delta, i));
+    NeuralGradW(dW[pos], pos ? nh.A[pos - 1] : x, delta, !pos && dropped);
 
-        MatrixDot_(dW[pos], MatrixTranspose(arena, nh.A[pos - 1]), delta);
+    /*MatrixPrint(dW[pos]);*/
 
-        /*MatrixPrint(dW[pos]);*/
+    // LAYERS: { 2, 18, 1 }
+    //           ^
+    // WEIGHT SIZES: { 2x18, 18x1 }
+    //                  ^
+    // OUTPUT SIZES: { Bx18, Bx1 }
 
-        // LAYERS: { 2, 18, 1 }
-        //           ^
-        // WEIGHT SIZES: { 2x18, 18x1 }
-        //                  ^
-        // OUTPUT SIZES: { 1x18, 1x1 }
+    while (pos--)
+    {
+        // NOTE(liam): delta = 2 * delta . W^T * act'(Z)
+        Matrix error = ws->delta[pos];
+        MatrixGemm_(error, delta, false, nn.W[pos + 1], true, 2.0f, 0.f);
+        ActivationBackward(nn.activation, nh.Z[pos].V, nh.A[pos].V, error.V, error.rows, error.cols);
+        delta = error;
 
-        while (pos--)
-        {
-            dZ = MatrixCopy(arena, nh.A[pos]);
-            MatrixApply(dZ, dsigmoidf);
+        MatrixFill(dB[pos], 0.0f);
+        for (size_t i = 0; i < delta.rows; i++) MatrixSum(dB[pos], MatrixRow(delta, i));
 
-            error = MatrixDot(arena, delta, MatrixTranspose(arena, nn.W[pos + 1]));
-            MatrixMulS_(error, error, 2.0f);
-            delta = MatrixMulM(arena, error, dZ);
+        // use x on the last iteration at first layer
+        NeuralGradW(dW[pos], pos ? nh.A[pos - 1] : x, delta, !pos && dropped);
+    }
+}
 
-            MatrixCopy_(dB[pos], delta);
+void NeuralNetApplyGradients(NeuralNet nn, NeuralBack grad, float32 scale)
+{
+    // NOTE(liam): params -= scale * grad. with matching flat buffers this is
+    // one pass over every weight and bias (padding stays zero).
+    const SimdKernels *simd = SimdGet();
+    if (nn.params && grad.flat && nn.paramCount == grad.flatCount)
+    {
+        simd->axpy(nn.params, -scale, grad.flat, nn.paramCount);
+        return;
+    }
 
-            if (pos)
-            {
-                MatrixDot_(dW[pos], MatrixTranspose(arena, nh.A[pos - 1]), delta);
-            }
-            else
-            {
-                // use x on the last iteration at first layer
-                MatrixDot_(dW[pos], MatrixTranspose(arena, x), delta);
-            }
-        }
+    for (uint32 i = 0; i < nn.layerCount - 1; i++)
+    {
+        simd->axpy(nn.W[i].V, -scale, grad.dW[i].V, nn.W[i].rows * nn.W[i].cols);
+        simd->axpy(nn.B[i].V, -scale, grad.dB[i].V, nn.B[i].cols);
     }
+}
 
-    return nb;
+void NeuralNetStep(NeuralWorkspace *ws, NeuralNet nn, Matrix x, Matrix y, float32 rate)
+{
+    NeuralNetBackpropInto(ws, nn, x, y);
+    NeuralNetApplyGradients(nn, ws->grad, rate / x.rows);
 }
 
 
@@ -340,83 +488,304 @@ void NeuralNetLearn(Arena *arena, RandomSeries *series,
         NeuralNet nn, Matrix x_train, Matrix y_train,
         uint32 epochs, float32 rate, uint32 batch_size)
 {
-    ArenaTemp tmp = ArenaScratchCreate(arena);
+    NeuralLearnConfig config = {0};
+    config.epochs = epochs;
+    config.rate = rate;
+    config.batchSize = batch_size;
+    config.threadCount = 1;
+
+    NeuralNetLearnWith(arena, series, nn, x_train, y_train, config);
+}
+
+// NOTE(liam): state shared by the data-parallel tasks for one batch.
+typedef struct neural_learn_shared {
+    NeuralNet nn;
+    NeuralWorkspace *shards; // one per thread
+    Matrix x;
+    Matrix y;
+    uint32 shardRows;
+    float32 scale;
+} NeuralLearnShared;
+
+static void
+NeuralLearnBackpropTask(void *ctx, uint32 index, uint32 count)
+{
+    NeuralLearnShared *sh = ctx;
+    NeuralWorkspace *ws = sh->shards + index;
+    (void)count;
 
-    uint32 n = x_train.rows * x_train.cols;
-    uint32 actualBatchCount = (int)(n / batch_size);
-    Matrix x_batches[actualBatchCount];
-    Matrix y_batches[actualBatchCount];
+    uint32 start = Min(index * sh->shardRows, (uint32)sh->x.rows);
+    uint32 end = Min(start + sh->shardRows, (uint32)sh->x.rows);
 
-    for (uint32 e = 0; e < epochs; e++)
+    if (start == end)
     {
-        /*uint32 shuffleCount = x_train.cols - 1;*/
-        /*uint32 swapIdx[shuffleCount * 2];*/
-        /*MatrixRandomShuffleRow(series, x_train, shuffleCount, swapIdx);*/
-        /*MatrixShuffleCol(y_train, swapIdx, y_train.cols - 1);*/
+        // NOTE(liam): more threads than rows; this shard adds nothing.
+        NeuralBackZero(ws->grad);
+        return;
+    }
 
-        /*if (batch_size == 1)*/
-        /*{*/
-        /*    NeuralNetUpdate(arena, nn, x_train, y_train, batch_size, rate);*/
-        /*}*/
-        /*else*/
-        {
-            for (int j = 0; j < n; j += batch_size)
-            {
-                x_batches[j] = MatrixSliceRow(arena, x_train, j, j + batch_size);
-                y_batches[j] = MatrixSliceRow(arena, y_train, j, j + batch_size);
-            }
+    Matrix x = MatrixViewRows(sh->x, start, end);
+    Matrix y = MatrixViewRows(sh->y, start, end);
+    NeuralNetBackpropInto(ws, sh->nn, x, y);
+}
 
-            for (int j = 0; j < actualBatchCount; j++)
-            {
-                NeuralNetUpdate(arena, nn, x_batches[j], y_batches[j], batch_size, rate);
-            }
+// NOTE(liam): each thread owns a slice of the flat gradient, rounded to
+// whole cache lines so neighbouring slices do not share one. it sums that
+// slice over the shards as a pairwise tree (0+1, 2+3, ... then 0+2, ...)
+// into shard 0 and applies the update. the order never depends on
+// timing, only on the shard count.
+static void
+NeuralLearnReduceTask(void *ctx, uint32 index, uint32 count)
+{
+    NeuralLearnShared *sh = ctx;
+    const SimdKernels *simd = SimdGet();
+
+    size_t total = sh->nn.paramCount;
+    size_t chunk = AlignPow2((total + count - 1) / count, 16);
+    size_t start = Min(index * chunk, total);
+    size_t n = Min(start + chunk, total) - start;
+    if (!n) return;
+
+    for (uint32 stride = 1; stride < count; stride *= 2)
+    {
+        for (uint32 s = 0; s + stride < count; s += 2 * stride)
+        {
+            simd->sum(sh->shards[s].grad.flat + start, sh->shards[s + stride].grad.flat + start, n);
         }
-        /*printf("Epoch %lu completed.\n", e);*/
     }
 
-    ArenaScratchFree(tmp);
+    simd->axpy(sh->nn.params + start, -sh->scale, sh->shards[0].grad.flat + start, n);
 }
 
+// NOTE(liam): hogwild state. the counter is the only synchronized value;
+// weight reads and writes race on purpose.
+typedef struct neural_hogwild_shared {
+    NeuralNet nn;
+    NeuralWorkspace *workspaces; // one per thread
+    Matrix *x_batches;
+    Matrix *y_batches;
+    uint32 batchCount;
+    uint32 epochs;
+    float32 rate;
+    uint64 updateCount;
+    NeuralThreadStats *stats;
+} NeuralHogwildShared;
+
+static void
+NeuralHogwildTask(void *ctx, uint32 index, uint32 count)
+{
+    NeuralHogwildShared *sh = ctx;
+    NeuralWorkspace *ws = sh->workspaces + index;
+    NeuralThreadStats stats = {0};
+    uint64 stalenessSum = 0;
 
+    float64 start = TimeNow();
+    for (uint32 e = 0; e < sh->epochs; e++)
+    {
+        // NOTE(liam): thread t takes batches t, t + count, ...; threads
+        // never wait on each other, even across epochs.
+        for (uint32 j = index; j < sh->batchCount; j += count)
+        {
+            Matrix x = sh->x_batches[j];
+            Matrix y = sh->y_batches[j];
+
+            uint64 seen = __atomic_load_n(&sh->updateCount, __ATOMIC_RELAXED);
+            NeuralNetBackpropInto(ws, sh->nn, x, y);
+            NeuralNetApplyGradients(sh->nn, ws->grad, sh->rate / x.rows);
+            uint64 before = __atomic_fetch_add(&sh->updateCount, 1, __ATOMIC_RELAXED);
+
+            uint64 staleness = before - seen;
+            stalenessSum += staleness;
+            stats.maxStaleness = Max(stats.maxStaleness, staleness);
+            stats.examples += x.rows;
+            stats.updates++;
+        }
+    }
+    stats.seconds = TimeNow() - start;
 
-void NeuralNetUpdate(Arena *arena, NeuralNet nn,
-                     Matrix x_train, Matrix y_train,
-                     uint32 exampleCount, float32 rate)
+    if (sh->stats)
+    {
+        stats.examplesPerSecond = stats.seconds > 0 ? stats.examples / stats.seconds : 0;
+        stats.meanStaleness = stats.updates ? (float64)stalenessSum / stats.updates : 0;
+        sh->stats[index] = stats;
+    }
+}
+
+// NOTE(liam): batch j of an epoch. in file order it is a view of its rows
+// of x_train; shuffled, its rows are gathered through order into the one
+// batch buffer, which the previous batch is done with by now.
+static void
+NeuralLearnBatch(Matrix x_train, Matrix y_train, const uint32 *order, Matrix xBuf, Matrix yBuf,
+                 uint32 j, uint32 batchSize, Matrix *x, Matrix *y)
 {
-    Matrix *dW = PushArray(arena, Matrix, nn.layerCount - 1);
-    Row *dB = PushArray(arena, Row, nn.layerCount - 1);
+    uint32 start = j * batchSize;
+    uint32 end = Min(start + batchSize, (uint32)x_train.rows);
+    if (!order)
+    {
+        *x = MatrixViewRows(x_train, start, end);
+        *y = MatrixViewRows(y_train, start, end);
+        return;
+    }
 
-    for (uint32 l = 0; l < nn.layerCount - 1; l++)
+    *x = MatrixViewRows(xBuf, 0, end - start);
+    *y = MatrixViewRows(yBuf, 0, end - start);
+    MatrixGatherRows(*x, x_train, order + start);
+    MatrixGatherRows(*y, y_train, order + start);
+}
+
+void NeuralNetLearnWith(Arena *arena, RandomSeries *series,
+        NeuralNet nn, Matrix x_train, Matrix y_train,
+        NeuralLearnConfig config)
+{
+    // NOTE(liam): batches and workspaces live in this thread's scratch, so
+    // nothing is left behind in arena.
+    ArenaTemp tmp = ArenaGetScratch(&arena, 1);
+    Arena *scratch = tmp.arena;
+
+    uint32 batch_size = config.batchSize ? config.batchSize : Max(x_train.rows, 1);
+    uint32 threadCount = config.threadCount ? config.threadCount : ThreadPoolCpuCount();
+
+    // NOTE(liam): one batch per batch_size rows; the last one takes
+    // whatever is left over. the buffers and workspaces are set up once,
+    // so the epoch loop itself does not allocate. in file order a batch is
+    // a view of its rows of x_train, so nothing is copied at all; shuffled,
+    // each batch is gathered into one batch-sized buffer right before its
+    // step (see NeuralLearnBatch).
+    uint32 n = x_train.rows;
+    if (!n)
     {
-        dW[l] = MatrixArenaAlloc(arena, nn.layerSizes[l], nn.layerSizes[l + 1]);
-        dB[l] = RowArenaAlloc(arena, nn.layerSizes[l + 1]);
+        ArenaReleaseScratch(tmp);
+        return;
+    }
+    uint32 actualBatchCount = (n + batch_size - 1) / batch_size;
+    uint32 rowsPerBatch = Min(batch_size, n);
 
-        // TODO(liam): this could be unnecessary.
-        MatrixFill(dW[l], 0.0f);
-        MatrixFill(dB[l], 0.0f);
+    uint32 *order = NULL;
+    Matrix xBuf = {0};
+    Matrix yBuf = {0};
+    if (config.shuffle)
+    {
+        order = PushArray(scratch, uint32, n);
+        for (uint32 i = 0; i < n; i++) order[i] = i;
+    }
+    if (order && config.mode != NeuralLearn_Hogwild)
+    {
+        xBuf = MatrixArenaAlloc(scratch, rowsPerBatch, x_train.cols);
+        yBuf = MatrixArenaAlloc(scratch, rowsPerBatch, y_train.cols);
     }
 
-    for (uint32 i = 0; i < exampleCount; i++)
+    if (config.mode == NeuralLearn_Hogwild)
     {
-        NeuralBack nb = NeuralNetBackprop(arena, nn,
-                                          MatrixRow(x_train, i),
-                                          MatrixRow(y_train, i));
+        // NOTE(liam): threads run through every epoch with no barrier, so
+        // batches cannot share a buffer. a shuffled run is permuted once
+        // and materialized as a full copy of the training set, one buffer
+        // per batch; in file order the batches are views.
+        Matrix *x_batches = PushArray(scratch, Matrix, actualBatchCount);
+        Matrix *y_batches = PushArray(scratch, Matrix, actualBatchCount);
+        if (order) RandomShuffle(series, order, n);
+        for (uint32 j = 0; j < actualBatchCount; j++)
+        {
+            uint32 rows = Min(batch_size, n - j * batch_size);
+            if (order)
+            {
+                xBuf = MatrixArenaAlloc(scratch, rows, x_train.cols);
+                yBuf = MatrixArenaAlloc(scratch, rows, y_train.cols);
+            }
+            NeuralLearnBatch(x_train, y_train, order, xBuf, yBuf, j, batch_size, x_batches + j, y_batches + j);
+        }
 
-        for (uint32 j = 0; j < nn.layerCount - 1; j++)
+        ThreadPool pool;
+        ThreadPoolInit(&pool, threadCount);
+        threadCount = pool.threadCount;
+
+        NeuralHogwildShared sh = {0};
+        sh.nn = nn;
+        sh.x_batches = x_batches;
+        sh.y_batches = y_batches;
+        sh.batchCount = actualBatchCount;
+        sh.epochs = config.epochs;
+        sh.rate = config.rate;
+        sh.stats = config.stats;
+        sh.workspaces = PushArray(scratch, NeuralWorkspace, threadCount);
+        for (uint32 t = 0; t < threadCount; t++)
         {
-            MatrixSum(dB[j], nb.dB[j]);
-            MatrixSum(dW[j], nb.dW[j]);
+            NeuralWorkspaceInit(scratch, sh.workspaces + t, nn, rowsPerBatch);
         }
+
+        ThreadPoolRun(&pool, NeuralHogwildTask, &sh);
+        ThreadPoolDestroy(&pool);
     }
+    else if (threadCount <= 1)
+    {
+        NeuralWorkspace ws = {0};
+        NeuralWorkspaceInit(scratch, &ws, nn, rowsPerBatch);
 
-    for (uint32 i = 0; i < nn.layerCount - 1; i++)
+        for (uint32 e = 0; e < config.epochs; e++)
+        {
+            if (order) RandomShuffle(series, order, n);
+
+            for (uint32 j = 0; j < actualBatchCount; j++)
+            {
+                Matrix x, y;
+                NeuralLearnBatch(x_train, y_train, order, xBuf, yBuf, j, batch_size, &x, &y);
+                NeuralNetStep(&ws, nn, x, y, config.rate);
+            }
+            /*printf("Epoch %lu completed.\n", e);*/
+        }
+    }
+    else
     {
-        float32 actualRate = rate / exampleCount;
+        Assert(nn.params && "data-parallel training needs the flat parameter buffer");
 
-        MatrixMulS_(dW[i], dW[i], actualRate);
-        MatrixSubM_(nn.W[i], nn.W[i], dW[i]);
+        ThreadPool pool;
+        ThreadPoolInit(&pool, threadCount);
+        threadCount = pool.threadCount;
 
-        MatrixMulS_(dB[i], dB[i], actualRate);
-        MatrixSubM_(nn.B[i], nn.B[i], dB[i]);
+        NeuralLearnShared sh = {0};
+        sh.nn = nn;
+        sh.shards = PushArray(scratch, NeuralWorkspace, threadCount);
+        for (uint32 t = 0; t < threadCount; t++)
+        {
+            NeuralWorkspaceInit(scratch, sh.shards + t, nn, (rowsPerBatch + threadCount - 1) / threadCount);
+        }
+
+        for (uint32 e = 0; e < config.epochs; e++)
+        {
+            if (order) RandomShuffle(series, order, n);
+
+            for (uint32 j = 0; j < actualBatchCount; j++)
+            {
+                NeuralLearnBatch(x_train, y_train, order, xBuf, yBuf, j, batch_size, &sh.x, &sh.y);
+                sh.shardRows = (sh.x.rows + threadCount - 1) / threadCount;
+                sh.scale = config.rate / sh.x.rows;
+
+                ThreadPoolRun(&pool, NeuralLearnBackpropTask, &sh);
+                ThreadPoolRun(&pool, NeuralLearnReduceTask, &sh);
+            }
+        }
+
+        ThreadPoolDestroy(&pool);
     }
+
+    ArenaReleaseScratch(tmp);
+}
+
+
+
+void NeuralNetUpdate(Arena *arena, NeuralNet nn,
+                     Matrix x_train, Matrix y_train,
+                     uint32 exampleCount, float32 rate)
+{
+    // NOTE(liam): the first exampleCount rows form one batch. this is the
+    // one-off form of NeuralNetStep; loops should keep a workspace instead.
+    Matrix x = MatrixViewRows(x_train, 0, exampleCount);
+    Matrix y = MatrixViewRows(y_train, 0, exampleCount);
+
+    ArenaTemp tmp = ArenaGetScratch(&arena, 1);
+
+    NeuralWorkspace ws = {0};
+    NeuralWorkspaceInit(tmp.arena, &ws, nn, exampleCount);
+    NeuralNetStep(&ws, nn, x, y, rate);
+
+    ArenaReleaseScratch(tmp);
 }
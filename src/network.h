@@ -1,4 +1,8 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
 #include "matrix.h"
+#include "activation.h"
 #include <math.h>
 #include "random.h"
 
@@ -11,6 +15,7 @@
 #endif
 
 #include "arena.h"
+#include "threadpool.h"
 
 typedef struct NeuralNet {
     uint32 layerCount;
@@ -19,20 +24,236 @@ typedef struct NeuralNet {
 
     Matrix *W;
     Row *B;
+
+    // NOTE(liam): every W[l] and B[l] is a view into this one 64-byte
+    // aligned buffer, each starting on a 16-float boundary (padding is
+    // kept at zero). see NeuralNetParamLayout.
+    float32 *params;
+    size_t paramCount;
+
+    // NOTE(liam): set when params point into a mapped model file.
+    void *mapping;
+    size_t mappingSize;
+
+    // NOTE(liam): zero-initialized nets use exact sigmoid everywhere.
+    ActivationKind activation;       // hidden layers
+    ActivationKind outputActivation; // last layer
+    ActivationAccuracy accuracy;
 } NeuralNet;
 
 // NOTE(liam): this will only exist inside functions pertaining to the
 // NeuralNet struct, so the size will always be derived from there.
+// Z is only needed by backprop; inference helpers leave it NULL.
+// each entry holds one row per example of the batch it was sized for.
 typedef struct NeuralForward {
     Row *Z;
     Row *A;
 } NeuralForward;
 
+// NOTE(liam): gradients share the parameter layout, so flat[i] is the
+// gradient of nn.params[i].
 typedef struct NeuralBack {
     Matrix *dW;
     Row *dB;
+
+    float32 *flat;
+    size_t flatCount;
 } NeuralBack;
 
+// NOTE(liam): everything one training step touches, sized once from the
+// net's shape and the largest batch. steps with fewer rows use the first
+// rows of each buffer, so nothing is allocated after init.
+typedef struct NeuralWorkspace {
+    uint32 batchCapacity;
+
+    NeuralForward fwd;  // Z, A: [batch x layer size]
+    Matrix *delta;      // [batch x layer size]
+    NeuralBack grad;    // dW, dB: summed over the batch
+
+    // NOTE(liam): rows left out of their batch's gradient because their
+    // loss was NaN or inf, over every step run on this workspace.
+    uint64 droppedRows;
+} NeuralWorkspace;
+
+// NOTE(liam): static memory plan. every tensor a training step (or an
+// inference pass) touches gets its lifetime from the layer order, and the
+// tensors share one block wherever lifetimes do not overlap, so the block
+// is the exact peak. plain SGD keeps no optimizer state, so the gradients
+// are the only tensor that lives across the whole step.
+typedef enum neural_memory_mode {
+    NeuralMemory_Train,
+    NeuralMemory_Inference,
+} NeuralMemoryMode;
+
+typedef enum neural_buffer_kind {
+    NeuralBuffer_Z,
+    NeuralBuffer_A,
+    NeuralBuffer_Delta,
+    NeuralBuffer_Grad,
+} NeuralBufferKind;
+
+typedef struct NeuralMemoryBuffer {
+    NeuralBufferKind kind;
+    uint32 layer;
+    uint32 first; // steps the buffer is live over, both included
+    uint32 last;
+    size_t offset; // bytes into the block, 64-byte aligned
+    size_t bytes;
+} NeuralMemoryBuffer;
+
+typedef struct NeuralMemoryPlan {
+    NeuralMemoryMode mode;
+    uint32 batchCapacity;
+    NeuralMemoryBuffer *buffers;
+    uint32 bufferCount;
+    size_t totalBytes; // the one block every buffer lives in
+    size_t naiveBytes; // what separate buffers would take
+} NeuralMemoryPlan;
+
+typedef enum neural_learn_mode {
+    // NOTE(liam): each batch is split into contiguous row shards, one per
+    // thread, and the shard gradients are summed in a fixed pairwise order
+    // before one update, so results are reproducible for a thread count.
+    NeuralLearn_Sync,
+    // NOTE(liam): hogwild. every thread takes its own batches and writes
+    // its update straight into the shared W/B with no locks; updates from
+    // other threads can land between a thread's read and its write.
+    NeuralLearn_Hogwild,
+} NeuralLearnMode;
+
+// NOTE(liam): staleness counts the updates other threads applied between
+// this thread reading the weights and writing its own update.
+typedef struct NeuralThreadStats {
+    uint64 examples;
+    uint64 updates;
+    float64 seconds;
+    float64 examplesPerSecond;
+    float64 meanStaleness;
+    uint64 maxStaleness;
+} NeuralThreadStats;
+
+// NOTE(liam): model file v2. little-endian, laid out as
+//   header | layer sizes (uint32 x layerCount) | pad to 64 | params
+// where params is nn.params byte for byte (same per-tensor padding), so
+// a save is one write and a mapped load points W/B at the file.
+// checksum is FNV-1a over the params as 64-bit words.
+#define NEURAL_FILE_MAGIC   0x32564E4Eu // "NNV2"
+#define NEURAL_FILE_VERSION 2
+
+typedef enum neural_dtype {
+    NeuralDType_F32,
+} NeuralDType;
+
+typedef struct neural_file_header {
+    uint32 magic;
+    uint32 version;
+    uint32 headerSize;
+    uint32 layerCount;
+    uint32 dtype;
+    uint32 activation;
+    uint32 outputActivation;
+    uint32 accuracy;
+    uint64 tableOffset;
+    uint64 dataOffset; // 64-byte aligned
+    uint64 dataSize;   // bytes
+    uint64 checksum;
+} NeuralFileHeader;
+
+typedef enum neural_load_flags {
+    NeuralLoad_Copy   = 0,      // read params into the arena
+    NeuralLoad_Map    = 1 << 0, // mmap the file read-only; W/B point into it
+    NeuralLoad_Verify = 1 << 1, // check the checksum (always done for copies)
+    NeuralLoad_Shared = 1 << 2, // with Map: MAP_SHARED, so every process
+                                // mapping the file uses the same pages
+} NeuralLoadFlags;
+
+// NOTE(liam): inference-only handle for worker processes. the weights are
+// a shared read-only mapping of the model file; the only private memory
+// is one activation buffer per layer for up to batchCapacity rows.
+typedef struct NeuralInference {
+    NeuralNet nn;
+    NeuralForward scratch;
+    uint32 batchCapacity;
+} NeuralInference;
+
+// NOTE(liam): a frozen, inference-only copy of a net. weights are packed
+// once into the GEMM kernel's panel layout and stored with the biases in
+// one buffer; bias and activation run in the GEMM epilogue, and layers
+// alternate between two activation buffers instead of keeping one per
+// layer. predicting allocates nothing.
+typedef struct NeuralPlanLayer {
+    uint32 inSize;
+    uint32 outSize;
+    GemmPackedB W;
+    const float32 *B;
+    ActivationKind activation;
+    ActivationRowFn *act; // fused; NULL for softmax (applied per row after)
+} NeuralPlanLayer;
+
+typedef struct NeuralPlanScratch {
+    float32 *ping; // tile rows x widest layer
+    float32 *pong;
+} NeuralPlanScratch;
+
+// NOTE(liam): tiles are sized so that both activation buffers of one tile
+// stay within roughly this many bytes (about an L2).
+#define NEURAL_PLAN_TILE_BYTES (256 * 1024)
+
+// NOTE(liam): the shareable half of a frozen net: shape and packed weights.
+// nothing writes to it after NeuralModelInit, so any number of threads may
+// predict with one model at once, each through its own NeuralContext.
+typedef struct NeuralModel {
+    uint32 layerCount; // weight layers, i.e. nn.layerCount - 1
+    NeuralPlanLayer *layers;
+    ActivationAccuracy accuracy;
+
+    uint32 inputSize;
+    uint32 outputSize;
+    uint32 tileRows; // rows per tile; scratch is sized for one tile
+    uint32 widest;
+
+    float32 *weights; // every packed W, then every bias
+    size_t weightCount;
+} NeuralModel;
+
+// NOTE(liam): the per-thread half. scratch comes from the context's own
+// arena, i.e. its own pages, so contexts never share a cache line.
+typedef struct NeuralContext {
+    const NeuralModel *model;
+    Arena arena;
+    NeuralPlanScratch scratch;
+} NeuralContext;
+
+// NOTE(liam): a model plus the scratch for one owner, which is all a
+// single-threaded caller needs.
+typedef struct NeuralPlan {
+    NeuralModel model;
+    uint32 batchCapacity;
+    NeuralPlanScratch own; // batchCapacity x widest layer
+
+    // NOTE(liam): set by NeuralPlanAttachPool; one scratch per pool thread.
+    ThreadPool *pool;
+    NeuralPlanScratch *scratch;
+} NeuralPlan;
+
+// NOTE(liam): batchSize 0 trains on the whole set as one batch.
+// threadCount 0 uses every online cpu. stats is optional and
+// must hold threadCount entries (ThreadPoolCpuCount() when 0); it is
+// only filled in hogwild mode.
+typedef struct NeuralLearnConfig {
+    uint32 epochs;
+    float32 rate;
+    uint32 batchSize;
+    uint32 threadCount;
+    NeuralLearnMode mode;
+    NeuralThreadStats *stats;
+    // NOTE(liam): reshuffle the rows every epoch. the batches are gathered
+    // through a permutation of row indices, so x_train and y_train are
+    // never moved and always stay in sync. hogwild shuffles once up front,
+    // since its threads never meet at an epoch boundary.
+    bool32 shuffle;
+} NeuralLearnConfig;
+
 float32 sigmoidf(float32 x);
 float32 dsigmoidf(float32 z);
 
@@ -40,16 +261,93 @@ float32 reluf(float32 x);
 float32 dreluf(float32 z);
 
 uint32 NeuralNetIndexSafe(NeuralNet nn, uint32 layerNum, uint32 index);
+
+// NOTE(liam): float offsets of each W[l]/B[l] inside the flat buffer
+// (either array may be NULL); returns the buffer length in floats.
+size_t NeuralNetParamLayout(NeuralNet nn, size_t *wOffsets, size_t *bOffsets);
+// NOTE(liam): points W[l]/B[l] at their slots inside base.
+void NeuralNetParamViews(NeuralNet nn, float32 *base, Matrix *W, Row *B);
+
+void NeuralBackZero(NeuralBack grad);
+float32 NeuralBackNorm(NeuralBack grad);
 void NeuralHelperInit(Arena *arena, NeuralForward *nh, NeuralNet nn);
+void NeuralHelperInitBatch(Arena *arena, NeuralForward *nh, NeuralNet nn, uint32 batchSize);
+void NeuralWorkspaceInit(Arena *arena, NeuralWorkspace *ws, NeuralNet nn, uint32 batchSize);
+void NeuralInferenceInit(Arena *arena, NeuralForward *nh, NeuralNet nn);
+void NeuralInferenceInitBatch(Arena *arena, NeuralForward *nh, NeuralNet nn, uint32 batchSize);
+// NOTE(liam): only nn's shape is read, so a plan can be made before the
+// weights exist. the Planned inits push one block of plan->totalBytes; the
+// buffers alias, so they only hold meaningful values while in use by the
+// step that owns them.
+bool32 NeuralMemoryPlanBuild(Arena *arena, NeuralMemoryPlan *plan, NeuralNet nn, uint32 batchSize, NeuralMemoryMode mode);
+void NeuralWorkspaceInitPlanned(Arena *arena, NeuralWorkspace *ws, NeuralNet nn, const NeuralMemoryPlan *plan);
+void NeuralInferenceInitPlanned(Arena *arena, NeuralForward *nh, NeuralNet nn, const NeuralMemoryPlan *plan);
 
 bool32 NeuralNetSave(NeuralNet nn, char *path);
 bool32 NeuralNetLoad(Arena *arena, NeuralNet *nn, char *path, uint32 *layerSizes, uint32 layerCount);
+// NOTE(liam): allocates nn.params for nn.layerSizes and makes W/B views.
+void NeuralNetAllocParams(Arena *arena, NeuralNet *nn);
+
+uint64 NeuralNetChecksum(const float32 *params, size_t count);
+// NOTE(liam): writes to path.tmp, then renames over path.
+bool32 NeuralNetSaveV2(NeuralNet nn, const char *path);
+// NOTE(liam): layer sizes and activations come from the file. a mapped
+// net is read-only: it can run inference but not train, and must be
+// released with NeuralNetUnmap.
+bool32 NeuralNetLoadV2(Arena *arena, NeuralNet *nn, const char *path, uint32 flags);
+void NeuralNetUnmap(NeuralNet *nn);
+
+bool32 NeuralInferenceOpen(Arena *arena, NeuralInference *inf, const char *path, uint32 batchCapacity);
+// NOTE(liam): x holds up to batchCapacity rows; returns a view of the
+// output rows, valid until the next run.
+Matrix NeuralInferenceRun(NeuralInference *inf, Matrix x);
+void NeuralInferenceClose(NeuralInference *inf);
+size_t NeuralInferenceScratchBytes(NeuralInference *inf);
+// NOTE(liam): tileRows 0 picks a cache-sized tile. the model is tied to
+// the simd level it was built under.
+bool32 NeuralModelInit(Arena *arena, NeuralModel *model, NeuralNet nn, uint32 tileRows);
+void NeuralModelScratchInit(Arena *arena, const NeuralModel *model, NeuralPlanScratch *scratch);
+// NOTE(liam): Y[i] = net(X[i]) for any number of rows, one tile at a time,
+// written straight into Y. Y must be X.rows x outputSize.
+void NeuralModelPredict(const NeuralModel *model, NeuralPlanScratch scratch, Matrix X, Matrix Y);
+
+bool32 NeuralContextInit(NeuralContext *ctx, const NeuralModel *model);
+void NeuralContextPredict(NeuralContext *ctx, Matrix X, Matrix Y);
+void NeuralContextFree(NeuralContext *ctx);
+
+bool32 NeuralNetFreeze(Arena *arena, NeuralPlan *plan, NeuralNet nn, uint32 batchCapacity);
+// NOTE(liam): x holds up to batchCapacity rows; returns a view of the
+// output rows, valid until the next predict.
+Matrix NeuralPlanPredict(NeuralPlan *plan, Matrix x);
+// NOTE(liam): lets NeuralNetPredictBatch split tiles across the pool's
+// threads. the pool must outlive its use by the plan.
+void NeuralPlanAttachPool(Arena *arena, NeuralPlan *plan, ThreadPool *pool);
+// NOTE(liam): NeuralModelPredict with the plan's scratch, split across its
+// pool when it has one.
+void NeuralNetPredictBatch(NeuralPlan *plan, Matrix X, Matrix Y);
+
 void NeuralNetSizePushSingle(Arena *arena, NeuralNet *nn, uint32 size);
 void NeuralNetSizePush(Arena *arena, NeuralNet *nn, uint32 *layerSizes, uint32 layerCount);
 void NeuralNetCompile(Arena* arena, RandomSeries *series, NeuralNet *nn, uint32 *layerSizes, uint32 layerCount, bool32 randomize_params);
 
+ActivationKind NeuralNetLayerActivation(NeuralNet nn, uint32 layer);
+// NOTE(liam): nn is only read and nh is written, so threads may share a
+// net as long as each brings its own NeuralForward.
 void NeuralNetForward(NeuralForward *nh, NeuralNet nn, Row x);
-NeuralBack NeuralNetBackprop(Arena *arena, NeuralNet nn, Row x, Row y);
+// NOTE(liam): x/y hold one example per row. the returned gradients are
+// summed over the rows, not averaged.
+NeuralBack NeuralNetBackprop(Arena *arena, NeuralNet nn, Matrix x, Matrix y);
+
+// NOTE(liam): allocation-free versions. gradients land in ws->grad, and
+// x may have at most ws->batchCapacity rows.
+void NeuralNetBackpropInto(NeuralWorkspace *ws, NeuralNet nn, Matrix x, Matrix y);
+void NeuralNetApplyGradients(NeuralNet nn, NeuralBack grad, float32 scale);
+void NeuralNetStep(NeuralWorkspace *ws, NeuralNet nn, Matrix x, Matrix y, float32 rate);
+// NOTE(liam): these keep their temporaries in the calling thread's scratch
+// arenas (ArenaGetScratch) and push nothing into arena, so threads may share
+// one.
 void NeuralNetUpdate(Arena *arena, NeuralNet nn, Matrix x_train, Matrix y_train, uint32 exampleCount, float32 rate);
 void NeuralNetLearn(Arena *arena, RandomSeries *series, NeuralNet nn, Matrix x_train, Matrix y_train, uint32 epochs, float32 rate, uint32 batch_size);
+void NeuralNetLearnWith(Arena *arena, RandomSeries *series, NeuralNet nn, Matrix x_train, Matrix y_train, NeuralLearnConfig config);
 
+#endif //NETWORK_H
@@ -0,0 +1,236 @@
+#include "network.h"
+
+bool32
+NeuralModelInit(Arena *arena, NeuralModel *model, NeuralNet nn, uint32 tileRows)
+{
+    *model = (NeuralModel){0};
+    if (nn.layerCount < 2 || !nn.W || !nn.B)
+    {
+        return false;
+    }
+
+    uint32 count = nn.layerCount - 1;
+    model->layerCount = count;
+    model->accuracy = nn.accuracy;
+    model->inputSize = nn.layerSizes[0];
+    model->outputSize = nn.layerSizes[count];
+    model->layers = PushArray(arena, NeuralPlanLayer, count);
+
+    // NOTE(liam): every tensor starts on a 64-byte boundary inside the one
+    // buffer; the micro-kernels load packed panels aligned.
+    size_t total = 0;
+    uint32 widest = 0;
+    for (uint32 l = 0; l < count; l++)
+    {
+        total += AlignPow2(GemmPackedBSize(nn.layerSizes[l], nn.layerSizes[l + 1]), 16);
+        total += AlignPow2(nn.layerSizes[l + 1], 16);
+        widest = Max(widest, nn.layerSizes[l + 1]);
+    }
+
+    model->weightCount = total;
+    model->weights = PushArrayAlign(arena, float32, total, 64);
+
+    float32 *at = model->weights;
+    for (uint32 l = 0; l < count; l++)
+    {
+        NeuralPlanLayer *layer = model->layers + l;
+        layer->inSize = nn.layerSizes[l];
+        layer->outSize = nn.layerSizes[l + 1];
+
+        GemmPackBInto(&layer->W, at, Gemm_N, layer->inSize, layer->outSize, nn.W[l].V, nn.W[l].stride);
+        at += AlignPow2(GemmPackedBSize(layer->inSize, layer->outSize), 16);
+    }
+    for (uint32 l = 0; l < count; l++)
+    {
+        NeuralPlanLayer *layer = model->layers + l;
+        SimdGet()->copy(at, nn.B[l].V, layer->outSize);
+        layer->B = at;
+        at += AlignPow2(layer->outSize, 16);
+
+        layer->activation = NeuralNetLayerActivation(nn, l);
+        layer->act = ActivationIsElementwise(layer->activation)
+                   ? ActivationGetRow(layer->activation, nn.accuracy) : NULL;
+    }
+
+    model->widest = widest;
+    if (!tileRows)
+    {
+        // NOTE(liam): rounded down to a multiple of 8 so every tile but the
+        // last fills whole micro-kernel row blocks.
+        tileRows = NEURAL_PLAN_TILE_BYTES / (2 * sizeof(float32) * widest);
+        tileRows = Max(tileRows & ~7u, 8);
+    }
+    model->tileRows = tileRows;
+    return true;
+}
+
+void
+NeuralModelScratchInit(Arena *arena, const NeuralModel *model, NeuralPlanScratch *scratch)
+{
+    size_t count = (size_t)model->tileRows * model->widest;
+    scratch->ping = PushArrayAlign(arena, float32, count, 64);
+    scratch->pong = PushArrayAlign(arena, float32, count, 64);
+}
+
+// NOTE(liam): rows of x through every layer, alternating ping and pong; the
+// last layer writes to out instead (row stride ldo).
+static void
+NeuralModelRun(const NeuralModel *model, NeuralPlanScratch scratch,
+               const float32 *x, size_t ldx, size_t rows, float32 *out, size_t ldo)
+{
+    const float32 *in = x;
+    size_t inStride = ldx;
+
+    for (uint32 l = 0; l < model->layerCount; l++)
+    {
+        const NeuralPlanLayer *layer = model->layers + l;
+        bool32 last = l + 1 == model->layerCount;
+        float32 *dst = last ? out : (l & 1) ? scratch.pong : scratch.ping;
+        size_t ldd = last ? ldo : layer->outSize;
+
+        GemmEpilogue ep = {0};
+        ep.bias = layer->B;
+        ep.act = layer->act;
+        GemmF32Packed(Gemm_N, rows, 1.f, in, inStride, &layer->W, 0.f, dst, ldd, &ep);
+
+        if (!ActivationIsElementwise(layer->activation))
+        {
+            ActivationApply(layer->activation, model->accuracy, dst, rows, layer->outSize, ldd);
+        }
+
+        in = dst;
+        inStride = ldd;
+    }
+}
+
+typedef struct neural_predict_shared {
+    const NeuralModel *model;
+    NeuralPlanScratch *scratch;
+    Matrix X;
+    Matrix Y;
+    uint32 tileCount;
+} NeuralPredictShared;
+
+static void
+NeuralPredictTask(void *ctx, uint32 index, uint32 count)
+{
+    NeuralPredictShared *sh = ctx;
+    const NeuralModel *model = sh->model;
+    NeuralPlanScratch scratch = sh->scratch[index];
+
+    // NOTE(liam): tiles are equal-sized, so a static stride balances well
+    // enough and keeps the split deterministic.
+    for (uint32 t = index; t < sh->tileCount; t += count)
+    {
+        size_t row = (size_t)t * model->tileRows;
+        size_t rows = Min(model->tileRows, sh->X.rows - row);
+        NeuralModelRun(model, scratch, &MatrixAT(sh->X, row, 0), sh->X.stride, rows,
+                       &MatrixAT(sh->Y, row, 0), sh->Y.stride);
+    }
+}
+
+static NeuralPredictShared
+NeuralPredictSplit(const NeuralModel *model, Matrix X, Matrix Y)
+{
+    Assert(X.cols == model->inputSize && "input width");
+    Assert(Y.rows == X.rows && Y.cols == model->outputSize && "output shape");
+
+    NeuralPredictShared res = {0};
+    res.model = model;
+    res.X = X;
+    res.Y = Y;
+    res.tileCount = (uint32)((X.rows + model->tileRows - 1) / model->tileRows);
+    return res;
+}
+
+void
+NeuralModelPredict(const NeuralModel *model, NeuralPlanScratch scratch, Matrix X, Matrix Y)
+{
+    NeuralPredictShared sh = NeuralPredictSplit(model, X, Y);
+    sh.scratch = &scratch;
+    NeuralPredictTask(&sh, 0, 1);
+}
+
+bool32
+NeuralContextInit(NeuralContext *ctx, const NeuralModel *model)
+{
+    *ctx = (NeuralContext){0};
+    ctx->model = model;
+    NeuralModelScratchInit(&ctx->arena, model, &ctx->scratch);
+    return ctx->scratch.ping && ctx->scratch.pong;
+}
+
+void
+NeuralContextPredict(NeuralContext *ctx, Matrix X, Matrix Y)
+{
+    NeuralModelPredict(ctx->model, ctx->scratch, X, Y);
+}
+
+void
+NeuralContextFree(NeuralContext *ctx)
+{
+    ArenaFree(&ctx->arena);
+    *ctx = (NeuralContext){0};
+}
+
+bool32
+NeuralNetFreeze(Arena *arena, NeuralPlan *plan, NeuralNet nn, uint32 batchCapacity)
+{
+    *plan = (NeuralPlan){0};
+    if (!NeuralModelInit(arena, &plan->model, nn, 0))
+    {
+        return false;
+    }
+
+    plan->batchCapacity = Max(batchCapacity, 1);
+    plan->model.tileRows = Min(plan->model.tileRows, plan->batchCapacity);
+
+    size_t count = (size_t)plan->batchCapacity * plan->model.widest;
+    plan->own.ping = PushArrayAlign(arena, float32, count, 64);
+    plan->own.pong = PushArrayAlign(arena, float32, count, 64);
+    return true;
+}
+
+Matrix
+NeuralPlanPredict(NeuralPlan *plan, Matrix x)
+{
+    NeuralModel *model = &plan->model;
+    Assert(x.rows <= plan->batchCapacity && x.cols == model->inputSize);
+
+    float32 *out = (model->layerCount & 1) ? plan->own.ping : plan->own.pong;
+    NeuralModelRun(model, plan->own, x.V, x.stride, x.rows, out, model->outputSize);
+
+    return MatrixAlloc(x.rows, model->outputSize, out);
+}
+
+void
+NeuralPlanAttachPool(Arena *arena, NeuralPlan *plan, ThreadPool *pool)
+{
+    plan->pool = pool;
+    plan->scratch = PushArray(arena, NeuralPlanScratch, pool->threadCount);
+
+    // NOTE(liam): the calling thread always runs index 0, so it keeps the
+    // plan's own buffers.
+    plan->scratch[0] = plan->own;
+    for (uint32 t = 1; t < pool->threadCount; t++)
+    {
+        NeuralModelScratchInit(arena, &plan->model, plan->scratch + t);
+    }
+}
+
+void
+NeuralNetPredictBatch(NeuralPlan *plan, Matrix X, Matrix Y)
+{
+    NeuralPredictShared sh = NeuralPredictSplit(&plan->model, X, Y);
+
+    if (plan->pool && plan->pool->threadCount > 1 && sh.tileCount > 1)
+    {
+        sh.scratch = plan->scratch;
+        ThreadPoolRun(plan->pool, NeuralPredictTask, &sh);
+    }
+    else
+    {
+        sh.scratch = &plan->own;
+        NeuralPredictTask(&sh, 0, 1);
+    }
+}
@@ -69,3 +69,14 @@ RandomBetween(RandomSeries* series, float32 min, float32 max)
     return(res);
 }
 
+void
+RandomShuffle(RandomSeries *series, uint32 *indices, uint32 count)
+{
+    for (uint32 i = count; i > 1; i--)
+    {
+        uint32 j = RandomChoice(series, i);
+        uint32 tmp = indices[i - 1];
+        indices[i - 1] = indices[j];
+        indices[j] = tmp;
+    }
+}
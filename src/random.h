@@ -21,4 +21,6 @@ uint32 RandomChoice(RandomSeries* series, uint32 N); // [0, N)
 float32 RandomUnilateral(RandomSeries* series); // [0,1]
 float32 RandomBilateral(RandomSeries* series); // [-1,1]
 float32 RandomBetween(RandomSeries* series, float32 min, float32 max); // (min, max)
+// NOTE(liam): fisher-yates over the given indices, in place.
+void RandomShuffle(RandomSeries* series, uint32 *indices, uint32 count);
 #endif //RANDOM_H
@@ -0,0 +1,618 @@
+#define _GNU_SOURCE
+#include "serve.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+
+static uint32
+NeuralHistogramIndex(uint64 value)
+{
+    if (value < NEURAL_HISTOGRAM_SUB) return (uint32)value;
+
+    uint32 e = 63 - __builtin_clzll(value);
+    uint32 sub = (uint32)(value >> (e - 3)) & (NEURAL_HISTOGRAM_SUB - 1);
+    return NEURAL_HISTOGRAM_SUB + (e - 3) * NEURAL_HISTOGRAM_SUB + sub;
+}
+
+static uint64
+NeuralHistogramUpper(uint32 index)
+{
+    if (index < NEURAL_HISTOGRAM_SUB) return index;
+
+    uint32 e = (index - NEURAL_HISTOGRAM_SUB) / NEURAL_HISTOGRAM_SUB + 3;
+    uint64 sub = (index - NEURAL_HISTOGRAM_SUB) % NEURAL_HISTOGRAM_SUB;
+    uint64 lower = (NEURAL_HISTOGRAM_SUB + sub) << (e - 3);
+    return lower + (1ull << (e - 3)) - 1;
+}
+
+void
+NeuralHistogramAdd(NeuralHistogram *h, uint64 value)
+{
+    h->buckets[NeuralHistogramIndex(value)]++;
+    h->count++;
+    h->sum += value;
+    h->max = Max(h->max, value);
+}
+
+uint64
+NeuralHistogramPercentile(NeuralHistogram *h, float64 p)
+{
+    if (!h->count) return 0;
+
+    uint64 rank = (uint64)ceil(p / 100.0 * (float64)h->count);
+    rank = Max(rank, 1);
+
+    uint64 seen = 0;
+    for (uint32 i = 0; i < NEURAL_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += h->buckets[i];
+        if (seen >= rank) return Min(NeuralHistogramUpper(i), h->max);
+    }
+    return h->max;
+}
+
+// NOTE(liam): client side only. the server's sockets are non-blocking and
+// it never waits on a send; see NeuralServerQueue.
+static bool32
+ServeSendAll(int fd, struct iovec *iov, int iovCount)
+{
+    while (iovCount)
+    {
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovCount;
+
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        while (iovCount && (size_t)sent >= iov->iov_len)
+        {
+            sent -= iov->iov_len;
+            iov++;
+            iovCount--;
+        }
+        if (iovCount)
+        {
+            iov->iov_base = (uint8 *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+static bool32
+ServeRecvAll(int fd, void *data, size_t size)
+{
+    uint8 *p = data;
+    while (size)
+    {
+        ssize_t got = recv(fd, p, size, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got;
+        size -= got;
+    }
+    return true;
+}
+
+bool32
+NeuralServerInit(Arena *arena, NeuralServer *server, NeuralPlan *plan, NeuralServeConfig config)
+{
+    *server = (NeuralServer){0};
+    server->listenFd = -1;
+    server->wakeFds[0] = server->wakeFds[1] = -1;
+
+    config.maxBatch = Min(config.maxBatch ? config.maxBatch : plan->batchCapacity, plan->batchCapacity);
+    config.maxClients = config.maxClients ? config.maxClients : 64;
+    // NOTE(liam): room for at least one full reply, so a client that reads
+    // is never cut off.
+    uint32 replyBytes = sizeof(NeuralServeFrame) + config.maxBatch * plan->model.outputSize * sizeof(float32);
+    config.maxBacklog = Max(config.maxBacklog ? config.maxBacklog : 4 * replyBytes, replyBytes);
+    server->config = config;
+    server->plan = plan;
+
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(config.socketPath) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "serve failed! socket path too long: %s\n", config.socketPath);
+        return false;
+    }
+    strcpy(addr.sun_path, config.socketPath);
+
+    if (pipe(server->wakeFds) != 0)
+    {
+        perror("pipe");
+        return false;
+    }
+
+    server->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(config.socketPath);
+    if (server->listenFd < 0 ||
+        bind(server->listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listenFd, (int)config.maxClients) != 0)
+    {
+        fprintf(stderr, "serve failed! %s: %s\n", config.socketPath, strerror(errno));
+        NeuralServerClose(server);
+        return false;
+    }
+
+    size_t frameBytes = sizeof(NeuralServeFrame) + (size_t)config.maxBatch * plan->model.inputSize * sizeof(float32);
+    server->clients = PushArray(arena, NeuralServeClient, config.maxClients);
+    for (uint32 c = 0; c < config.maxClients; c++)
+    {
+        server->clients[c].fd = -1;
+        server->clients[c].recv = PushArrayAlign(arena, uint8, frameBytes, 64);
+        server->clients[c].send = PushArray(arena, uint8, config.maxBacklog);
+    }
+
+    // NOTE(liam): slots 0 and 1 are the wake pipe and the listener.
+    server->pollFds = PushArray(arena, struct pollfd, config.maxClients + 2);
+    server->pollSlots = PushArray(arena, uint32, config.maxClients + 2);
+
+    // NOTE(liam): every pending request holds at least one row.
+    server->pending = PushArray(arena, NeuralServePending, config.maxBatch);
+    server->X = MatrixArenaAlloc(arena, config.maxBatch, plan->model.inputSize);
+    server->Y = MatrixArenaAlloc(arena, config.maxBatch, plan->model.outputSize);
+
+    server->running = true;
+    return true;
+}
+
+// NOTE(liam): hands the socket what it takes now and appends the rest to
+// the client's backlog, in order. false if the send failed or the backlog
+// would pass maxBacklog.
+static bool32
+NeuralServerQueue(NeuralServer *server, NeuralServeClient *client, struct iovec *iov, int iovCount)
+{
+    size_t total = 0;
+    for (int i = 0; i < iovCount; i++) total += iov[i].iov_len;
+
+    size_t sent = 0;
+    if (!client->sendUsed)
+    {
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovCount;
+
+        ssize_t res;
+        while ((res = sendmsg(client->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT)) < 0 && errno == EINTR) {}
+        if (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+        sent = res > 0 ? (size_t)res : 0;
+    }
+
+    size_t left = total - sent;
+    if (!left) return true;
+    if (left > server->config.maxBacklog - client->sendUsed) return false;
+
+    if (client->sendHead + client->sendUsed + left > server->config.maxBacklog)
+    {
+        memmove(client->send, client->send + client->sendHead, client->sendUsed);
+        client->sendHead = 0;
+    }
+
+    uint8 *at = client->send + client->sendHead + client->sendUsed;
+    for (int i = 0; i < iovCount; i++)
+    {
+        size_t skip = Min(sent, iov[i].iov_len);
+        memcpy(at, (uint8 *)iov[i].iov_base + skip, iov[i].iov_len - skip);
+        at += iov[i].iov_len - skip;
+        sent -= skip;
+    }
+    client->sendUsed += left;
+    return true;
+}
+
+// NOTE(liam): sends from the backlog until the socket is full. false if
+// the send failed; the backlog is then thrown away.
+static bool32
+NeuralServerDrain(NeuralServeClient *client)
+{
+    while (client->sendUsed)
+    {
+        ssize_t sent = send(client->fd, client->send + client->sendHead, client->sendUsed, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            client->sendUsed = 0;
+            client->sendHead = 0;
+            return false;
+        }
+        client->sendHead += sent;
+        client->sendUsed -= sent;
+    }
+    client->sendHead = 0;
+    return true;
+}
+
+// NOTE(liam): closes the slot right away. callers make sure no pending
+// request still refers to it before the slot can be reused.
+static void
+NeuralServerRelease(NeuralServer *server, uint32 index)
+{
+    NeuralServeClient *client = server->clients + index;
+    close(client->fd);
+    client->fd = -1;
+    client->recvUsed = 0;
+    client->sendHead = 0;
+    client->sendUsed = 0;
+    client->closing = false;
+    server->clientCount--;
+}
+
+static void
+NeuralServerFlush(NeuralServer *server)
+{
+    if (!server->pendingCount) return;
+
+    uint32 rows = server->pendingRows;
+    NeuralNetPredictBatch(server->plan, MatrixViewRows(server->X, 0, rows),
+                          MatrixViewRows(server->Y, 0, rows));
+
+    for (uint32 i = 0; i < server->pendingCount; i++)
+    {
+        NeuralServePending *p = server->pending + i;
+        NeuralServeClient *client = server->clients + p->client;
+
+        struct iovec iov[2];
+        iov[0].iov_base = &p->frame;
+        iov[0].iov_len = sizeof(p->frame);
+        iov[1].iov_base = server->Y.V + (size_t)p->row * server->Y.cols;
+        iov[1].iov_len = (size_t)p->frame.rows * server->Y.cols * sizeof(float32);
+
+        // NOTE(liam): a client that went away mid-batch just loses its reply,
+        // and so do the rest of its requests once it is cut off here.
+        if (client->fd >= 0 && !NeuralServerQueue(server, client, iov, 2))
+        {
+            NeuralServerRelease(server, p->client);
+            server->dropped++;
+        }
+
+        NeuralHistogramAdd(&server->latencyUs, (uint64)((TimeNow() - p->arrived) * 1e6));
+    }
+
+    NeuralHistogramAdd(&server->batchRows, rows);
+    server->batches++;
+    server->pendingCount = 0;
+    server->pendingRows = 0;
+}
+
+static void
+NeuralServerDrop(NeuralServer *server, uint32 index)
+{
+    // NOTE(liam): pending requests refer to clients by slot, so the batch
+    // goes out before the slot can be reused. replies still queued are
+    // drained first; the client stops being read meanwhile.
+    NeuralServerFlush(server);
+    NeuralServeClient *client = server->clients + index;
+    if (client->fd < 0) return;
+    if (client->sendUsed)
+    {
+        client->closing = true;
+        return;
+    }
+    NeuralServerRelease(server, index);
+}
+
+static void
+NeuralServerReject(NeuralServer *server, uint32 index, NeuralServeFrame frame, NeuralServeStatus status)
+{
+    // NOTE(liam): replies owed for earlier requests go out ahead of the
+    // rejection.
+    NeuralServerFlush(server);
+    NeuralServeClient *client = server->clients + index;
+    if (client->fd < 0) return;
+
+    frame.status = status;
+    struct iovec iov = { &frame, sizeof(frame) };
+    if (!NeuralServerQueue(server, client, &iov, 1))
+    {
+        client->sendUsed = 0;
+    }
+    NeuralServerDrop(server, index);
+}
+
+// NOTE(liam): reads whatever the client has sent without blocking, and
+// queues every request that is now complete. returns false once the
+// client is gone.
+static bool32
+NeuralServerRead(NeuralServer *server, uint32 index)
+{
+    NeuralServeClient *client = server->clients + index;
+    size_t rowBytes = server->plan->model.inputSize * sizeof(float32);
+
+    for (;;)
+    {
+        NeuralServeFrame frame = {0};
+        size_t need = sizeof(frame);
+        if (client->recvUsed >= sizeof(frame))
+        {
+            memcpy(&frame, client->recv, sizeof(frame));
+            need += frame.rows * rowBytes;
+        }
+
+        ssize_t got = recv(client->fd, client->recv + client->recvUsed, need - client->recvUsed, MSG_DONTWAIT);
+        if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            NeuralServerDrop(server, index);
+            return false;
+        }
+        if (got < 0)
+        {
+            if (errno == EINTR) continue;
+            return true;
+        }
+
+        client->recvUsed += got;
+        if (client->recvUsed == sizeof(frame))
+        {
+            // NOTE(liam): a bad header cannot be skipped over, since the
+            // row count is what says where the next one starts.
+            memcpy(&frame, client->recv, sizeof(frame));
+            if (frame.magic != NEURAL_SERVE_MAGIC || frame.rows == 0)
+            {
+                NeuralServerReject(server, index, frame, NeuralServe_BadFrame);
+                return false;
+            }
+            if (frame.rows > server->config.maxBatch)
+            {
+                NeuralServerReject(server, index, frame, NeuralServe_TooManyRows);
+                return false;
+            }
+            continue;
+        }
+        if (client->recvUsed < need) continue;
+
+        if (server->pendingRows + frame.rows > server->config.maxBatch)
+        {
+            NeuralServerFlush(server);
+        }
+
+        NeuralServePending *p = server->pending + server->pendingCount++;
+        p->client = index;
+        p->row = server->pendingRows;
+        p->frame = frame;
+        p->frame.status = NeuralServe_Ok;
+        p->arrived = TimeNow();
+
+        memcpy(server->X.V + (size_t)p->row * server->X.cols, client->recv + sizeof(frame), frame.rows * rowBytes);
+        server->pendingRows += frame.rows;
+        client->recvUsed = 0;
+
+        if (server->pendingRows == server->config.maxBatch)
+        {
+            NeuralServerFlush(server);
+        }
+    }
+}
+
+static void
+NeuralServerAccept(NeuralServer *server)
+{
+    int fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK);
+    if (fd < 0) return;
+
+    uint32 slot = 0;
+    while (slot < server->config.maxClients && server->clients[slot].fd >= 0) slot++;
+    if (slot == server->config.maxClients)
+    {
+        close(fd);
+        return;
+    }
+
+    NeuralServeHello hello = {0};
+    hello.magic = NEURAL_SERVE_MAGIC;
+    hello.inputSize = server->plan->model.inputSize;
+    hello.outputSize = server->plan->model.outputSize;
+    hello.maxRows = server->config.maxBatch;
+
+    NeuralServeClient *client = server->clients + slot;
+    client->fd = fd;
+    client->recvUsed = 0;
+    client->sendHead = 0;
+    client->sendUsed = 0;
+    client->closing = false;
+
+    struct iovec iov = { &hello, sizeof(hello) };
+    if (!NeuralServerQueue(server, client, &iov, 1))
+    {
+        close(fd);
+        client->fd = -1;
+        return;
+    }
+    server->clientCount++;
+}
+
+void
+NeuralServerRun(NeuralServer *server)
+{
+    uint32 maxClients = server->config.maxClients;
+    struct pollfd *fds = server->pollFds;
+    uint32 *slotOf = server->pollSlots;
+
+    while (server->running)
+    {
+        uint32 n = 0;
+        fds[n++] = (struct pollfd){ server->wakeFds[0], POLLIN, 0 };
+        fds[n++] = (struct pollfd){ server->listenFd, POLLIN, 0 };
+        for (uint32 c = 0; c < maxClients; c++)
+        {
+            NeuralServeClient *client = server->clients + c;
+            if (client->fd < 0) continue;
+
+            short events = client->closing ? 0 : POLLIN;
+            if (client->sendUsed) events |= POLLOUT;
+            slotOf[n] = c;
+            fds[n++] = (struct pollfd){ client->fd, events, 0 };
+        }
+
+        // NOTE(liam): with a batch open, wait no longer than its oldest
+        // request has left before the delay bound.
+        struct timespec timeout;
+        struct timespec *wait = NULL;
+        if (server->pendingCount)
+        {
+            float64 left = server->pending[0].arrived + server->config.maxDelayUs * 1e-6 - TimeNow();
+            if (left <= 0.0)
+            {
+                NeuralServerFlush(server);
+                continue;
+            }
+            timeout.tv_sec = (time_t)left;
+            timeout.tv_nsec = (long)((left - (float64)timeout.tv_sec) * 1e9);
+            wait = &timeout;
+        }
+
+        int ready = ppoll(fds, n, wait, NULL);
+        if (ready < 0)
+        {
+            if (errno == EINTR) continue;
+            perror("ppoll");
+            break;
+        }
+
+        if (fds[0].revents)
+        {
+            server->running = false;
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            NeuralServerAccept(server);
+        }
+        for (uint32 i = 2; i < n; i++)
+        {
+            short revents = fds[i].revents;
+            NeuralServeClient *client = server->clients + slotOf[i];
+            if (!revents) continue;
+            // NOTE(liam): a drop above may have closed this slot already.
+            if (client->fd != fds[i].fd) continue;
+
+            if (client->sendUsed && !NeuralServerDrain(client))
+            {
+                NeuralServerDrop(server, slotOf[i]);
+                continue;
+            }
+            if (client->closing)
+            {
+                if (!client->sendUsed || (revents & (POLLERR | POLLHUP))) NeuralServerRelease(server, slotOf[i]);
+                continue;
+            }
+            if (revents & (POLLIN | POLLERR | POLLHUP)) NeuralServerRead(server, slotOf[i]);
+        }
+    }
+
+    NeuralServerFlush(server);
+}
+
+void
+NeuralServerStop(NeuralServer *server)
+{
+    uint8 b = 1;
+    if (write(server->wakeFds[1], &b, 1) < 0) {}
+}
+
+void
+NeuralServerClose(NeuralServer *server)
+{
+    for (uint32 c = 0; server->clients && c < server->config.maxClients; c++)
+    {
+        if (server->clients[c].fd >= 0) close(server->clients[c].fd);
+        server->clients[c].fd = -1;
+    }
+    if (server->listenFd >= 0)
+    {
+        close(server->listenFd);
+        unlink(server->config.socketPath);
+    }
+    if (server->wakeFds[0] >= 0) close(server->wakeFds[0]);
+    if (server->wakeFds[1] >= 0) close(server->wakeFds[1]);
+
+    server->listenFd = -1;
+    server->wakeFds[0] = server->wakeFds[1] = -1;
+    server->clientCount = 0;
+}
+
+void
+NeuralServerReport(NeuralServer *server, FILE *out)
+{
+    NeuralHistogram *lat = &server->latencyUs;
+    NeuralHistogram *rows = &server->batchRows;
+
+    fprintf(out, "requests %llu  batches %llu  mean batch %.2f rows  clients dropped %llu\n",
+            (unsigned long long)lat->count, (unsigned long long)server->batches,
+            rows->count ? (float64)rows->sum / rows->count : 0.0, (unsigned long long)server->dropped);
+    fprintf(out, "latency us  p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu\n",
+            (unsigned long long)NeuralHistogramPercentile(lat, 50.0),
+            (unsigned long long)NeuralHistogramPercentile(lat, 90.0),
+            (unsigned long long)NeuralHistogramPercentile(lat, 99.0),
+            (unsigned long long)NeuralHistogramPercentile(lat, 99.9),
+            (unsigned long long)lat->max);
+
+    fprintf(out, "batch rows:\n");
+    uint64 lower = 0;
+    for (uint32 i = 0; i < NEURAL_HISTOGRAM_BUCKETS; i++)
+    {
+        uint64 upper = NeuralHistogramUpper(i);
+        if (rows->buckets[i])
+        {
+            fprintf(out, "  %5llu - %-5llu %llu\n", (unsigned long long)lower,
+                    (unsigned long long)upper, (unsigned long long)rows->buckets[i]);
+        }
+        lower = upper + 1;
+    }
+}
+
+int
+NeuralServeConnect(const char *socketPath, NeuralServeHello *hello)
+{
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, socketPath);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        !ServeRecvAll(fd, hello, sizeof(*hello)) ||
+        hello->magic != NEURAL_SERVE_MAGIC)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool32
+NeuralServePredict(int fd, NeuralServeHello hello, uint64 id,
+                   const float32 *x, uint32 rows, float32 *y)
+{
+    NeuralServeFrame frame = {0};
+    frame.magic = NEURAL_SERVE_MAGIC;
+    frame.rows = rows;
+    frame.id = id;
+
+    struct iovec iov[2];
+    iov[0].iov_base = &frame;
+    iov[0].iov_len = sizeof(frame);
+    iov[1].iov_base = (void *)x;
+    iov[1].iov_len = (size_t)rows * hello.inputSize * sizeof(float32);
+    if (!ServeSendAll(fd, iov, 2)) return false;
+
+    NeuralServeFrame reply = {0};
+    if (!ServeRecvAll(fd, &reply, sizeof(reply)) || reply.status != NeuralServe_Ok || reply.id != id)
+    {
+        return false;
+    }
+    return ServeRecvAll(fd, y, (size_t)reply.rows * hello.outputSize * sizeof(float32));
+}
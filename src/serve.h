@@ -0,0 +1,130 @@
+/*
+ * ---------------
+ * Liam Bagabag
+ * Version: 1.0.0
+ * requires: network.h, posix sockets
+ * ---------------
+ */
+#ifndef SERVE_H
+#define SERVE_H
+
+#include "network.h"
+#include <poll.h>
+
+// NOTE(liam): wire protocol, native byte order (the socket is local).
+// on connect the server sends one NeuralServeHello. each request is a
+// NeuralServeFrame followed by rows x inputSize floats; the reply echoes
+// the frame (status filled in) followed by rows x outputSize floats, or
+// nothing when status is not ok. a client may pipeline requests.
+#define NEURAL_SERVE_MAGIC 0x5652534Eu // "NSRV"
+
+typedef enum neural_serve_status {
+    NeuralServe_Ok,
+    NeuralServe_BadFrame,
+    NeuralServe_TooManyRows,
+} NeuralServeStatus;
+
+typedef struct neural_serve_hello {
+    uint32 magic;
+    uint32 inputSize;
+    uint32 outputSize;
+    uint32 maxRows;
+} NeuralServeHello;
+
+typedef struct neural_serve_frame {
+    uint32 magic;
+    uint32 rows;
+    uint64 id;
+    uint32 status;
+    uint32 reserved;
+} NeuralServeFrame;
+
+// NOTE(liam): log-linear histogram: values below 8 get their own bucket,
+// above that each power of two is split into 8 linear sub-buckets, so a
+// percentile is off by at most 1/8 of its value.
+#define NEURAL_HISTOGRAM_SUB     8
+#define NEURAL_HISTOGRAM_BUCKETS (NEURAL_HISTOGRAM_SUB * 62)
+
+typedef struct NeuralHistogram {
+    uint64 count;
+    uint64 sum;
+    uint64 max;
+    uint64 buckets[NEURAL_HISTOGRAM_BUCKETS];
+} NeuralHistogram;
+
+void NeuralHistogramAdd(NeuralHistogram *h, uint64 value);
+// NOTE(liam): upper bound of the bucket holding the p-th percentile, p in [0, 100].
+uint64 NeuralHistogramPercentile(NeuralHistogram *h, float64 p);
+
+// NOTE(liam): a micro-batch is flushed as soon as it holds maxBatch rows
+// or its oldest request has waited maxDelayUs, whichever comes first.
+// replies a client leaves unread queue up to maxBacklog bytes (default four
+// full batches); past that the client is cut off.
+typedef struct NeuralServeConfig {
+    const char *socketPath;
+    uint32 maxBatch;
+    uint32 maxDelayUs;
+    uint32 maxClients;
+    uint32 maxBacklog;
+} NeuralServeConfig;
+
+typedef struct neural_serve_client {
+    int fd;
+    uint8 *recv;     // one frame header + its rows
+    size_t recvUsed;
+    uint8 *send;     // replies the socket has not taken yet
+    size_t sendHead;
+    size_t sendUsed;
+    bool32 closing;  // rejected: close once send is drained
+} NeuralServeClient;
+
+typedef struct neural_serve_pending {
+    uint32 client;
+    uint32 row;      // first row inside the batch
+    NeuralServeFrame frame;
+    float64 arrived;
+} NeuralServePending;
+
+typedef struct NeuralServer {
+    NeuralServeConfig config;
+    NeuralPlan *plan;
+
+    int listenFd;
+    int wakeFds[2]; // NeuralServerStop writes here
+    bool32 running;
+
+    NeuralServeClient *clients;
+    uint32 clientCount;
+    struct pollfd *pollFds;
+    uint32 *pollSlots;
+
+    // NOTE(liam): the batch being gathered, as rows of X.
+    NeuralServePending *pending;
+    uint32 pendingCount;
+    uint32 pendingRows;
+    Matrix X;
+    Matrix Y;
+
+    NeuralHistogram latencyUs; // arrival of the full request to reply sent or queued
+    NeuralHistogram batchRows;
+    uint64 batches;
+    uint64 dropped; // clients cut off with replies owed: full backlog or a failed send
+} NeuralServer;
+
+// NOTE(liam): the plan's batchCapacity bounds maxBatch. everything is
+// allocated here; serving allocates nothing.
+bool32 NeuralServerInit(Arena *arena, NeuralServer *server, NeuralPlan *plan, NeuralServeConfig config);
+// NOTE(liam): blocks until NeuralServerStop.
+void NeuralServerRun(NeuralServer *server);
+// NOTE(liam): async-signal-safe; may be called from any thread.
+void NeuralServerStop(NeuralServer *server);
+void NeuralServerClose(NeuralServer *server);
+void NeuralServerReport(NeuralServer *server, FILE *out);
+
+// NOTE(liam): client side. connect fills in the hello; predict sends one
+// request and waits for its reply.
+int NeuralServeConnect(const char *socketPath, NeuralServeHello *hello);
+bool32 NeuralServePredict(int fd, NeuralServeHello hello, uint64 id,
+                          const float32 *x, uint32 rows, float32 *y);
+
+#endif //SERVE_H
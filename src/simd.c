@@ -0,0 +1,431 @@
+#include "simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ARCH_X64) || defined(ARCH_X86)
+# include <cpuid.h>
+# include <immintrin.h>
+# define SIMD_X86 1
+#endif
+
+// NOTE(liam): scalar reference kernels. these are also the tail handlers
+// for the sse4/avx2 variants.
+static void
+SimdAddScalar(float32 *c, const float32 *a, const float32 *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) c[i] = a[i] + b[i];
+}
+
+static void
+SimdSubScalar(float32 *c, const float32 *a, const float32 *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) c[i] = a[i] - b[i];
+}
+
+static void
+SimdMulScalar(float32 *c, const float32 *a, const float32 *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) c[i] = a[i] * b[i];
+}
+
+static void
+SimdAddSScalar(float32 *b, const float32 *a, float32 x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) b[i] = a[i] + x;
+}
+
+static void
+SimdSubSScalar(float32 *b, const float32 *a, float32 x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) b[i] = a[i] - x;
+}
+
+static void
+SimdMulSScalar(float32 *b, const float32 *a, float32 x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) b[i] = a[i] * x;
+}
+
+static void
+SimdSumScalar(float32 *b, const float32 *a, size_t n)
+{
+    for (size_t i = 0; i < n; i++) b[i] += a[i];
+}
+
+static void
+SimdAxpyScalar(float32 *y, float32 alpha, const float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) y[i] += alpha * x[i];
+}
+
+static float32
+SimdDotScalar(const float32 *a, const float32 *b, size_t n)
+{
+    float32 res = 0.f;
+    for (size_t i = 0; i < n; i++) res += a[i] * b[i];
+    return res;
+}
+
+static void
+SimdFillScalar(float32 *a, float32 x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) a[i] = x;
+}
+
+static void
+SimdCopyScalar(float32 *b, const float32 *a, size_t n)
+{
+    memmove(b, a, n * sizeof(float32));
+}
+
+static const SimdKernels SimdKernelsScalar = {
+    SimdLevel_Scalar,
+    SimdAddScalar, SimdSubScalar, SimdMulScalar,
+    SimdAddSScalar, SimdSubSScalar, SimdMulSScalar,
+    SimdSumScalar, SimdAxpyScalar, SimdDotScalar, SimdFillScalar, SimdCopyScalar,
+};
+
+#ifdef SIMD_X86
+// NOTE(liam): the sse4 and avx2 variants only differ in vector type and
+// width, so they are stamped out from the same bodies. leftovers (< W)
+// go through the scalar kernels.
+#define SIMD_DEFINE_KERNELS(S, TARGET, V, W, LOADU, STOREU, SET1, ADD, SUB, MUL, FMA, HSUM) \
+    __attribute__((target(TARGET))) static void \
+    SimdAdd##S(float32 *c, const float32 *a, const float32 *b, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(c + i, ADD(LOADU(a + i), LOADU(b + i))); \
+        SimdAddScalar(c + i, a + i, b + i, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdSub##S(float32 *c, const float32 *a, const float32 *b, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(c + i, SUB(LOADU(a + i), LOADU(b + i))); \
+        SimdSubScalar(c + i, a + i, b + i, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdMul##S(float32 *c, const float32 *a, const float32 *b, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(c + i, MUL(LOADU(a + i), LOADU(b + i))); \
+        SimdMulScalar(c + i, a + i, b + i, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdAddS##S(float32 *b, const float32 *a, float32 x, size_t n) \
+    { \
+        V vx = SET1(x); \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(b + i, ADD(LOADU(a + i), vx)); \
+        SimdAddSScalar(b + i, a + i, x, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdSubS##S(float32 *b, const float32 *a, float32 x, size_t n) \
+    { \
+        V vx = SET1(x); \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(b + i, SUB(LOADU(a + i), vx)); \
+        SimdSubSScalar(b + i, a + i, x, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdMulS##S(float32 *b, const float32 *a, float32 x, size_t n) \
+    { \
+        V vx = SET1(x); \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(b + i, MUL(LOADU(a + i), vx)); \
+        SimdMulSScalar(b + i, a + i, x, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdSum##S(float32 *b, const float32 *a, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(b + i, ADD(LOADU(b + i), LOADU(a + i))); \
+        SimdSumScalar(b + i, a + i, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdAxpy##S(float32 *y, float32 alpha, const float32 *x, size_t n) \
+    { \
+        V va = SET1(alpha); \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(y + i, FMA(va, LOADU(x + i), LOADU(y + i))); \
+        SimdAxpyScalar(y + i, alpha, x + i, n - i); \
+    } \
+    __attribute__((target(TARGET))) static float32 \
+    SimdDot##S(const float32 *a, const float32 *b, size_t n) \
+    { \
+        V acc = SET1(0.f); \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) acc = FMA(LOADU(a + i), LOADU(b + i), acc); \
+        return HSUM(acc) + SimdDotScalar(a + i, b + i, n - i); \
+    } \
+    __attribute__((target(TARGET))) static void \
+    SimdFill##S(float32 *a, float32 x, size_t n) \
+    { \
+        V vx = SET1(x); \
+        size_t i = 0; \
+        for (; i + W <= n; i += W) STOREU(a + i, vx); \
+        SimdFillScalar(a + i, x, n - i); \
+    } \
+    static const SimdKernels SimdKernels##S = { \
+        SimdLevel_##S, \
+        SimdAdd##S, SimdSub##S, SimdMul##S, \
+        SimdAddS##S, SimdSubS##S, SimdMulS##S, \
+        SimdSum##S, SimdAxpy##S, SimdDot##S, SimdFill##S, SimdCopyScalar, \
+    };
+
+#define SIMD_SSE4_FMA(a, x, y) _mm_add_ps(_mm_mul_ps((a), (x)), (y))
+
+__attribute__((target("sse4.1"))) static inline float32
+SimdHsumSSE4(__m128 v)
+{
+    v = _mm_hadd_ps(v, v);
+    v = _mm_hadd_ps(v, v);
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("avx2,fma"))) static inline float32
+SimdHsumAVX2(__m256 v)
+{
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_hadd_ps(lo, lo);
+    lo = _mm_hadd_ps(lo, lo);
+    return _mm_cvtss_f32(lo);
+}
+
+SIMD_DEFINE_KERNELS(SSE4, "sse4.1", __m128, 4,
+                    _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps,
+                    _mm_add_ps, _mm_sub_ps, _mm_mul_ps, SIMD_SSE4_FMA, SimdHsumSSE4)
+
+SIMD_DEFINE_KERNELS(AVX2, "avx2,fma", __m256, 8,
+                    _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+                    _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_fmadd_ps, SimdHsumAVX2)
+
+// NOTE(liam): avx-512 handles the tail with a masked load/store instead of
+// falling back to scalar.
+#define SIMD_AVX512_LOOP(EXPR) \
+    size_t i = 0; \
+    for (; i + 16 <= n; i += 16) \
+    { \
+        __mmask16 m = 0xFFFF; (void)m; \
+        _mm512_storeu_ps(out + i, EXPR); \
+    } \
+    if (i < n) \
+    { \
+        __mmask16 m = (__mmask16)((1u << (n - i)) - 1); \
+        _mm512_mask_storeu_ps(out + i, m, EXPR); \
+    }
+
+#define SIMD_AVX512_LOAD(p) _mm512_maskz_loadu_ps(m, (p) + i)
+
+__attribute__((target("avx512f"))) static void
+SimdAddAVX512(float32 *c, const float32 *a, const float32 *b, size_t n)
+{
+    float32 *out = c;
+    SIMD_AVX512_LOOP(_mm512_add_ps(SIMD_AVX512_LOAD(a), SIMD_AVX512_LOAD(b)))
+}
+
+__attribute__((target("avx512f"))) static void
+SimdSubAVX512(float32 *c, const float32 *a, const float32 *b, size_t n)
+{
+    float32 *out = c;
+    SIMD_AVX512_LOOP(_mm512_sub_ps(SIMD_AVX512_LOAD(a), SIMD_AVX512_LOAD(b)))
+}
+
+__attribute__((target("avx512f"))) static void
+SimdMulAVX512(float32 *c, const float32 *a, const float32 *b, size_t n)
+{
+    float32 *out = c;
+    SIMD_AVX512_LOOP(_mm512_mul_ps(SIMD_AVX512_LOAD(a), SIMD_AVX512_LOAD(b)))
+}
+
+__attribute__((target("avx512f"))) static void
+SimdAddSAVX512(float32 *b, const float32 *a, float32 x, size_t n)
+{
+    float32 *out = b;
+    __m512 vx = _mm512_set1_ps(x);
+    SIMD_AVX512_LOOP(_mm512_add_ps(SIMD_AVX512_LOAD(a), vx))
+}
+
+__attribute__((target("avx512f"))) static void
+SimdSubSAVX512(float32 *b, const float32 *a, float32 x, size_t n)
+{
+    float32 *out = b;
+    __m512 vx = _mm512_set1_ps(x);
+    SIMD_AVX512_LOOP(_mm512_sub_ps(SIMD_AVX512_LOAD(a), vx))
+}
+
+__attribute__((target("avx512f"))) static void
+SimdMulSAVX512(float32 *b, const float32 *a, float32 x, size_t n)
+{
+    float32 *out = b;
+    __m512 vx = _mm512_set1_ps(x);
+    SIMD_AVX512_LOOP(_mm512_mul_ps(SIMD_AVX512_LOAD(a), vx))
+}
+
+__attribute__((target("avx512f"))) static void
+SimdSumAVX512(float32 *b, const float32 *a, size_t n)
+{
+    float32 *out = b;
+    SIMD_AVX512_LOOP(_mm512_add_ps(SIMD_AVX512_LOAD(b), SIMD_AVX512_LOAD(a)))
+}
+
+__attribute__((target("avx512f"))) static void
+SimdAxpyAVX512(float32 *y, float32 alpha, const float32 *x, size_t n)
+{
+    float32 *out = y;
+    __m512 va = _mm512_set1_ps(alpha);
+    SIMD_AVX512_LOOP(_mm512_fmadd_ps(va, SIMD_AVX512_LOAD(x), SIMD_AVX512_LOAD(y)))
+}
+
+__attribute__((target("avx512f"))) static float32
+SimdDotAVX512(const float32 *a, const float32 *b, size_t n)
+{
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc);
+    }
+    if (i < n)
+    {
+        __mmask16 m = (__mmask16)((1u << (n - i)) - 1);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f"))) static void
+SimdFillAVX512(float32 *a, float32 x, size_t n)
+{
+    float32 *out = a;
+    __m512 vx = _mm512_set1_ps(x);
+    SIMD_AVX512_LOOP(vx)
+}
+
+static const SimdKernels SimdKernelsAVX512 = {
+    SimdLevel_AVX512,
+    SimdAddAVX512, SimdSubAVX512, SimdMulAVX512,
+    SimdAddSAVX512, SimdSubSAVX512, SimdMulSAVX512,
+    SimdSumAVX512, SimdAxpyAVX512, SimdDotAVX512, SimdFillAVX512, SimdCopyScalar,
+};
+
+static uint64
+SimdXgetbv(void)
+{
+    uint32 lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64)hi << 32) | lo;
+}
+#endif
+
+SimdLevel
+SimdDetect(void)
+{
+    SimdLevel res = SimdLevel_Scalar;
+#ifdef SIMD_X86
+    uint32 eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return res;
+    }
+
+    bool32 sse41   = (ecx >> 19) & 1;
+    bool32 fma     = (ecx >> 12) & 1;
+    bool32 osxsave = (ecx >> 27) & 1;
+    bool32 avx     = (ecx >> 28) & 1;
+
+    if (sse41)
+    {
+        res = SimdLevel_SSE4;
+    }
+
+    // NOTE(liam): the cpu having the instructions is not enough, the os has
+    // to save the wider registers on context switch (XCR0).
+    if (osxsave && avx && fma)
+    {
+        uint64 xcr0 = SimdXgetbv();
+        uint32 eax7, ebx7, ecx7, edx7;
+        if ((xcr0 & 0x6) == 0x6 && __get_cpuid_count(7, 0, &eax7, &ebx7, &ecx7, &edx7))
+        {
+            bool32 avx2    = (ebx7 >> 5) & 1;
+            bool32 avx512f = (ebx7 >> 16) & 1;
+
+            if (avx2)
+            {
+                res = SimdLevel_AVX2;
+                if (avx512f && (xcr0 & 0xE6) == 0xE6)
+                {
+                    res = SimdLevel_AVX512;
+                }
+            }
+        }
+    }
+#endif
+    return res;
+}
+
+const char *
+SimdLevelName(SimdLevel level)
+{
+    static const char *names[SimdLevel_Count] = { "scalar", "sse4", "avx2", "avx512" };
+    return level < SimdLevel_Count ? names[level] : "unknown";
+}
+
+static const SimdKernels *
+SimdKernelsForLevel(SimdLevel level)
+{
+    const SimdKernels *res = &SimdKernelsScalar;
+#ifdef SIMD_X86
+    switch (level)
+    {
+        case SimdLevel_SSE4:   res = &SimdKernelsSSE4; break;
+        case SimdLevel_AVX2:   res = &SimdKernelsAVX2; break;
+        case SimdLevel_AVX512: res = &SimdKernelsAVX512; break;
+        default: break;
+    }
+#endif
+    return res;
+}
+
+static const SimdKernels *SimdTable;
+
+__attribute__((constructor)) static void
+SimdInit(void)
+{
+    SimdLevel level = SimdDetect();
+
+    const char *cap = getenv("NN_SIMD");
+    if (cap)
+    {
+        for (uint32 l = 0; l < SimdLevel_Count; l++)
+        {
+            if (strcmp(cap, SimdLevelName((SimdLevel)l)) == 0)
+            {
+                level = Min(level, (SimdLevel)l);
+                break;
+            }
+        }
+    }
+
+    SimdTable = SimdKernelsForLevel(level);
+}
+
+const SimdKernels *
+SimdGet(void)
+{
+    if (!SimdTable) SimdInit();
+    return SimdTable;
+}
+
+bool32
+SimdSetLevel(SimdLevel level)
+{
+    bool32 res = false;
+    if (level < SimdLevel_Count && level <= SimdDetect())
+    {
+        SimdTable = SimdKernelsForLevel(level);
+        res = true;
+    }
+    return res;
+}
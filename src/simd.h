@@ -0,0 +1,54 @@
+/*
+ * ---------------
+ * Liam Bagabag
+ * Version: 1.0.0
+ * requires: n/a
+ * ---------------
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "def.h"
+
+// NOTE(liam): levels are ordered; a cpu that supports a level supports
+// every level below it.
+typedef enum simd_level {
+    SimdLevel_Scalar,
+    SimdLevel_SSE4,
+    SimdLevel_AVX2,   // AVX2 + FMA
+    SimdLevel_AVX512, // AVX-512F
+    SimdLevel_Count,
+} SimdLevel;
+
+// NOTE(liam): all kernels work on flat, contiguous float arrays of length n
+// and accept the output aliasing an input (in-place updates).
+typedef struct simd_kernels {
+    SimdLevel level;
+
+    void (*add)(float32 *c, const float32 *a, const float32 *b, size_t n);  // c = a + b
+    void (*sub)(float32 *c, const float32 *a, const float32 *b, size_t n);  // c = a - b
+    void (*mul)(float32 *c, const float32 *a, const float32 *b, size_t n);  // c = a * b
+
+    void (*addS)(float32 *b, const float32 *a, float32 x, size_t n);        // b = a + x
+    void (*subS)(float32 *b, const float32 *a, float32 x, size_t n);        // b = a - x
+    void (*mulS)(float32 *b, const float32 *a, float32 x, size_t n);        // b = a * x
+
+    void (*sum)(float32 *b, const float32 *a, size_t n);                    // b += a
+    void (*axpy)(float32 *y, float32 alpha, const float32 *x, size_t n);    // y += alpha * x
+    float32 (*dot)(const float32 *a, const float32 *b, size_t n);           // sum(a * b)
+    void (*fill)(float32 *a, float32 x, size_t n);
+    void (*copy)(float32 *b, const float32 *a, size_t n);
+} SimdKernels;
+
+SimdLevel SimdDetect(void);
+const char *SimdLevelName(SimdLevel level);
+
+// NOTE(liam): the table is picked once at startup from cpuid. setting the
+// environment variable NN_SIMD to scalar/sse4/avx2/avx512 caps the level.
+const SimdKernels *SimdGet(void);
+
+// NOTE(liam): for tests and benchmarks. returns false if the cpu cannot
+// run the requested level.
+bool32 SimdSetLevel(SimdLevel level);
+
+#endif //SIMD_H
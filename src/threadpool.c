@@ -0,0 +1,131 @@
+#include "threadpool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+static void *
+ThreadPoolWorkerMain(void *arg)
+{
+    ThreadPoolWorker *worker = arg;
+    ThreadPool *pool = worker->pool;
+    uint64 seen = 0;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->quit && pool->generation == seen)
+        {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->quit)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        ThreadPoolTask *task = pool->task;
+        void *ctx = pool->ctx;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(ctx, worker->index, pool->threadCount);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+bool32
+ThreadPoolInit(ThreadPool *pool, uint32 threadCount)
+{
+    *pool = (ThreadPool){0};
+    pool->threadCount = Max(threadCount, 1);
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    uint32 workerCount = pool->threadCount - 1;
+    if (!workerCount) return true;
+
+    pool->workers = calloc(workerCount, sizeof(ThreadPoolWorker));
+    if (!pool->workers)
+    {
+        pool->threadCount = 1;
+        return false;
+    }
+
+    for (uint32 i = 0; i < workerCount; i++)
+    {
+        ThreadPoolWorker *worker = pool->workers + i;
+        worker->pool = pool;
+        worker->index = i + 1;
+        if (pthread_create(&worker->thread, NULL, ThreadPoolWorkerMain, worker) != 0)
+        {
+            // NOTE(liam): keep whatever did start.
+            pool->threadCount = i + 1;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+ThreadPoolDestroy(ThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint32 i = 0; i + 1 < pool->threadCount; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    free(pool->workers);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    *pool = (ThreadPool){0};
+}
+
+void
+ThreadPoolRun(ThreadPool *pool, ThreadPoolTask *task, void *ctx)
+{
+    if (pool->threadCount > 1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->task = task;
+        pool->ctx = ctx;
+        pool->pending = pool->threadCount - 1;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    task(ctx, 0, pool->threadCount);
+
+    if (pool->threadCount > 1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending)
+        {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+uint32
+ThreadPoolCpuCount(void)
+{
+    long res = sysconf(_SC_NPROCESSORS_ONLN);
+    return res > 0 ? (uint32)res : 1;
+}
@@ -0,0 +1,52 @@
+/*
+ * ---------------
+ * Liam Bagabag
+ * Version: 1.0.0
+ * requires: pthreads
+ * ---------------
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include "def.h"
+#include <pthread.h>
+
+// NOTE(liam): a task runs once on every thread of the pool. index is in
+// [0, count) and the calling thread always takes index 0.
+typedef void ThreadPoolTask(void *ctx, uint32 index, uint32 count);
+
+typedef struct thread_pool_worker {
+    struct thread_pool *pool;
+    uint32 index;
+    pthread_t thread;
+} ThreadPoolWorker;
+
+typedef struct thread_pool {
+    uint32 threadCount; // workers + the calling thread
+    ThreadPoolWorker *workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+
+    // NOTE(liam): bumped once per ThreadPoolRun; workers sleep until it
+    // moves past the last generation they ran.
+    uint64 generation;
+    uint32 pending;
+    bool32 quit;
+
+    ThreadPoolTask *task;
+    void *ctx;
+} ThreadPool;
+
+// NOTE(liam): threadCount includes the caller, so 1 spawns nothing.
+bool32 ThreadPoolInit(ThreadPool *pool, uint32 threadCount);
+void ThreadPoolDestroy(ThreadPool *pool);
+
+// NOTE(liam): blocks until every thread has returned from task.
+// not reentrant: only one thread may call this at a time.
+void ThreadPoolRun(ThreadPool *pool, ThreadPoolTask *task, void *ctx);
+
+uint32 ThreadPoolCpuCount(void);
+
+#endif //THREADPOOL_H
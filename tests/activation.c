@@ -0,0 +1,174 @@
+#include "activation.h"
+#include "simd.h"
+#include <math.h>
+#include "random.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+// NOTE(liam): max absolute error of one accuracy mode against the libm
+// version, over a row long enough to hit the vector body and a tail.
+static float32
+ActivationMaxError(Arena *arena, ActivationKind kind, ActivationAccuracy accuracy,
+                   const float32 *x, size_t n)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    float32 *want = PushArray(arena, float32, n);
+    float32 *got = PushArray(arena, float32, n);
+    for (size_t i = 0; i < n; i++) want[i] = got[i] = x[i];
+
+    ActivationApply(kind, ActivationAccuracy_Exact, want, 1, n, n);
+    ActivationApply(kind, accuracy, got, 1, n, n);
+
+    float32 res = 0.f;
+    for (size_t i = 0; i < n; i++)
+    {
+        res = Max(res, fabsf(got[i] - want[i]));
+    }
+
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+// NOTE(liam): backward against a central difference of the exact forward,
+// with the incoming gradient set to 1 (or a one-hot for softmax).
+static bool32
+TestBackward(Arena *arena, ActivationKind kind, const float32 *x, size_t n)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    float32 *a = PushArray(arena, float32, n);
+    float32 *delta = PushArray(arena, float32, n);
+    float32 *hi = PushArray(arena, float32, n);
+    float32 *lo = PushArray(arena, float32, n);
+    float32 h = 1e-2f;
+    float32 err = 0.f;
+
+    for (size_t i = 0; i < n; i++) a[i] = x[i];
+    ActivationApply(kind, ActivationAccuracy_Exact, a, 1, n, n);
+
+    if (kind == Activation_Softmax)
+    {
+        // NOTE(liam): d a_0 / d x_j, from the jacobian-vector product with e_0.
+        for (size_t i = 0; i < n; i++) delta[i] = i == 0 ? 1.f : 0.f;
+        ActivationBackward(kind, x, a, delta, 1, n);
+        for (size_t j = 0; j < n; j++)
+        {
+            for (size_t i = 0; i < n; i++) hi[i] = lo[i] = x[i];
+            hi[j] += h;
+            lo[j] -= h;
+            ActivationApply(kind, ActivationAccuracy_Exact, hi, 1, n, n);
+            ActivationApply(kind, ActivationAccuracy_Exact, lo, 1, n, n);
+            err = Max(err, fabsf(delta[j] - (hi[0] - lo[0]) / (2.f * h)));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            delta[i] = 1.f;
+            hi[i] = x[i] + h;
+            lo[i] = x[i] - h;
+        }
+        ActivationBackward(kind, x, a, delta, 1, n);
+        ActivationApply(kind, ActivationAccuracy_Exact, hi, 1, n, n);
+        ActivationApply(kind, ActivationAccuracy_Exact, lo, 1, n, n);
+        for (size_t i = 0; i < n; i++)
+        {
+            // NOTE(liam): the relu kinks are not differentiable.
+            if (fabsf(x[i]) < h) continue;
+            err = Max(err, fabsf(delta[i] - (hi[i] - lo[i]) / (2.f * h)));
+        }
+    }
+
+    bool32 res = err < 2e-3f;
+    printf("backward %-10s max err %e %s\n", ActivationName(kind), err, res ? "ok" : "FAILED");
+
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+static void
+BenchActivation(Arena *arena, RandomSeries *series, ActivationKind kind, size_t n)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    float32 *x = PushArray(arena, float32, n);
+    float32 *y = PushArray(arena, float32, n);
+    for (size_t i = 0; i < n; i++) x[i] = RandomBetween(series, -8.f, 8.f);
+
+    printf("bench %-10s", ActivationName(kind));
+    for (uint32 acc = 0; acc < ActivationAccuracy_Count; acc++)
+    {
+        uint32 reps = 16;
+        float64 start = TimeNow();
+        for (uint32 r = 0; r < reps; r++)
+        {
+            for (size_t i = 0; i < n; i++) y[i] = x[i];
+            ActivationApply(kind, (ActivationAccuracy)acc, y, 1, n, n);
+        }
+        float64 ns = (TimeNow() - start) / reps / n * 1e9;
+        printf("  %s %.2f ns/elem", acc == 0 ? "exact" : acc == 1 ? "approx" : "fast", ns);
+    }
+    printf("\n");
+
+    ArenaTempEnd(tmp);
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    bool32 ok = true;
+
+    size_t n = 1003;
+    float32 *x = PushArray(&arena, float32, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        // NOTE(liam): mostly the useful range, plus saturating inputs.
+        x[i] = (i % 10 == 0) ? RandomBetween(&series, -100.f, 100.f) : RandomBetween(&series, -8.f, 8.f);
+    }
+
+    SimdLevel prev = SimdGet()->level;
+    SimdLevel best = SimdDetect();
+
+    for (uint32 level = 0; level <= best; level++)
+    {
+        SimdSetLevel((SimdLevel)level);
+        for (uint32 kind = 0; kind < Activation_Count; kind++)
+        {
+            float32 approx = ActivationMaxError(&arena, (ActivationKind)kind, ActivationAccuracy_Approx, x, n);
+            float32 fast = ActivationMaxError(&arena, (ActivationKind)kind, ActivationAccuracy_Fast, x, n);
+
+            // NOTE(liam): fast gelu is the tanh approximation of gelu, not
+            // of erf, so it is held to its own (looser) bound.
+            float32 fastBound = kind == Activation_Gelu ? 2e-3f : 1e-4f;
+            bool32 res = approx <= 1e-6f && fast <= fastBound;
+            printf("%-7s %-10s approx %e fast %e %s\n",
+                   SimdLevelName((SimdLevel)level), ActivationName((ActivationKind)kind),
+                   approx, fast, res ? "ok" : "FAILED");
+            ok = ok && res;
+        }
+    }
+    SimdSetLevel(prev);
+
+    float32 *small = PushArray(&arena, float32, 37);
+    for (size_t i = 0; i < 37; i++) small[i] = RandomBetween(&series, -3.f, 3.f);
+    for (uint32 kind = 0; kind < Activation_Count; kind++)
+    {
+        ok = TestBackward(&arena, (ActivationKind)kind, small, 37) && ok;
+    }
+
+    printf("simd level: %s\n", SimdLevelName(SimdGet()->level));
+    BenchActivation(&arena, &series, Activation_Sigmoid, 1 << 16);
+    BenchActivation(&arena, &series, Activation_Tanh, 1 << 16);
+    BenchActivation(&arena, &series, Activation_Gelu, 1 << 16);
+
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all activation tests passed." : "activation tests FAILED.");
+    return ok ? 0 : 1;
+}
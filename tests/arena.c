@@ -0,0 +1,288 @@
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+#include "test.h"
+#include <stdio.h>
+#include <pthread.h>
+
+// NOTE(liam): the shape of a training step: a scratch scope that outgrows
+// the first block, then is thrown away.
+static float64
+TempLoop(Arena *arena, uint32 steps)
+{
+    float64 start = TimeNow();
+    for (uint32 s = 0; s < steps; s++)
+    {
+        ArenaTemp tmp = ArenaTempBegin(arena);
+        for (uint32 i = 0; i < 4; i++)
+        {
+            uint8 *p = PushArray(arena, uint8, Kilobytes(64));
+            p[0] = (uint8)s;
+            p[Kilobytes(64) - 1] = (uint8)i;
+        }
+        ArenaTempEnd(tmp);
+    }
+    return TimeNow() - start;
+}
+
+// NOTE(liam): one float per 4 KiB page in a scattered order, so nearly
+// every load needs a fresh TLB entry unless the pages are huge.
+static float64
+PageWalk(float32 *x, size_t bytes, uint32 reps)
+{
+    size_t pages = bytes / Kilobytes(4);
+    size_t stride = Kilobytes(4) / sizeof(float32);
+    for (size_t p = 0; p < pages; p++) x[p * stride] = 1.f;
+
+    volatile float32 sum = 0.f;
+    float64 start = TimeNow();
+    for (uint32 r = 0; r < reps; r++)
+    {
+        size_t p = r;
+        for (size_t i = 0; i < pages; i++)
+        {
+            p = (p + 7919) % pages;
+            sum += x[p * stride];
+        }
+    }
+    (void)sum;
+    return TimeNow() - start;
+}
+
+typedef struct scratch_worker {
+    Arena *scratch[2];
+    bool32 ok;
+} ScratchWorker;
+
+// NOTE(liam): nested scratch scopes on a worker thread; the outer one plays
+// the caller's result arena for the inner one.
+static void *
+ScratchWorkerRun(void *ptr)
+{
+    ScratchWorker *w = ptr;
+    w->ok = true;
+    for (uint32 step = 0; step < 200; step++)
+    {
+        ArenaTemp outer = ArenaGetScratch(NULL, 0);
+        uint32 *results = PushArray(outer.arena, uint32, 1000);
+        ArenaTemp inner = ArenaGetScratch(&outer.arena, 1);
+        uint32 *temps = PushArray(inner.arena, uint32, 5000);
+        for (uint32 i = 0; i < 5000; i++) temps[i] = step + i;
+        for (uint32 i = 0; i < 1000; i++) results[i] = temps[i * 5];
+        ArenaReleaseScratch(inner);
+
+        for (uint32 i = 0; i < 1000; i++) w->ok = w->ok && results[i] == step + i * 5;
+        w->scratch[0] = outer.arena;
+        w->scratch[1] = inner.arena;
+        ArenaReleaseScratch(outer);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    bool32 ok = true;
+
+    {
+        ArenaBlockCache cache;
+        ArenaCacheInit(&cache, 0);
+
+        Arena arena = {0};
+        ArenaSetBlockCache(&arena, &cache);
+        PushArray(&arena, uint8, 100);
+
+        uint32 steps = 1000;
+        TempLoop(&arena, 1);
+        ArenaCacheStats warm = ArenaCacheGetStats(&cache);
+        float64 cached = TempLoop(&arena, steps);
+        ArenaCacheStats stats = ArenaCacheGetStats(&cache);
+
+        ok = Check(warm.misses == 5 && warm.cachedBlocks == 4, "first scope maps its blocks") && ok;
+        ok = Check(stats.misses == warm.misses && stats.hits == warm.hits + 4 * steps,
+                   "later scopes reuse them") && ok;
+        ok = Check(stats.cachedBlocks == 4 && stats.cachedBytes == 4 * Kilobytes(128),
+                   "blocks rounded to their class") && ok;
+
+        Arena plain = {0};
+        PushArray(&plain, uint8, 100);
+        float64 direct = TempLoop(&plain, steps);
+        printf("%u scopes: mmap/munmap %.2f ms, cached %.2f ms\n", steps, direct * 1e3, cached * 1e3);
+        ArenaFree(&plain);
+
+        ArenaCacheTrim(&cache, Kilobytes(128));
+        stats = ArenaCacheGetStats(&cache);
+        ok = Check(stats.cachedBytes == Kilobytes(128) && stats.unmapped == 3, "trim keeps what was asked") && ok;
+
+        ArenaFree(&arena);
+        stats = ArenaCacheGetStats(&cache);
+        ok = Check(stats.cachedBlocks == 2 && stats.cachedBytes == Kilobytes(128 + 16), "clear parks every block") && ok;
+        ArenaCacheTrim(&cache, 0);
+        ok = Check(ArenaCacheGetStats(&cache).cachedBytes == 0, "trim to zero empties the cache") && ok;
+    }
+
+    // NOTE(liam): over the cap a released block is unmapped, not parked.
+    {
+        ArenaBlockCache cache;
+        ArenaCacheInit(&cache, Kilobytes(128));
+
+        Arena arena = {0};
+        ArenaSetBlockCache(&arena, &cache);
+        ArenaTemp tmp = ArenaTempBegin(&arena);
+        PushArray(&arena, uint8, Kilobytes(100));
+        PushArray(&arena, uint8, Kilobytes(100));
+        ArenaTempEnd(tmp);
+
+        ArenaCacheStats stats = ArenaCacheGetStats(&cache);
+        ok = Check(stats.cachedBytes == Kilobytes(128) && stats.unmapped == 1, "cap is respected") && ok;
+
+        // NOTE(liam): the global cache is shared, and reused blocks come
+        // back through the same path.
+        Arena shared = {0};
+        ArenaSetBlockCache(&shared, ArenaGlobalCache());
+        uint64 before = ArenaCacheGetStats(ArenaGlobalCache()).hits;
+        PushArray(&shared, uint8, Kilobytes(20));
+        ArenaFree(&shared);
+        PushArray(&shared, uint8, Kilobytes(20));
+        ok = Check(ArenaCacheGetStats(ArenaGlobalCache()).hits == before + 1, "global cache reuses blocks") && ok;
+        ArenaFree(&shared);
+        ArenaCacheTrim(ArenaGlobalCache(), 0);
+        ArenaFree(&arena);
+        ArenaCacheTrim(&cache, 0);
+    }
+
+    // NOTE(liam): reserve mode: one range, committed on demand.
+    {
+        Arena arena = {0};
+        bool32 reserved = ArenaReserve(&arena, Gigabytes(64));
+        ok = Check(reserved && arena.committed == 0, "64 GiB reserved, nothing committed") && ok;
+
+        if (reserved)
+        {
+            float32 *a = PushArray(&arena, float32, Megabytes(1));
+            ArenaTemp tmp = ArenaTempBegin(&arena);
+            float32 *b = PushArrayAlign(&arena, float32, Megabytes(4), 64);
+            float32 *c = PushArray(&arena, float32, 3);
+            b[Megabytes(4) - 1] = 1.f;
+            c[2] = 2.f;
+            ok = Check((uint8 *)b == (uint8 *)(a + Megabytes(1)) && c == b + Megabytes(4) &&
+                       arena.blockCount == 1, "pushes are contiguous") && ok;
+            ok = Check(arena.committed >= arena.pos && arena.committed < arena.pos + ARENA_COMMIT_GRANULE,
+                       "commits track the position") && ok;
+
+            ArenaTempEnd(tmp);
+            ok = Check(arena.pos == Megabytes(4) && arena.committed > Megabytes(16), "temp end is a reset") && ok;
+
+            ArenaDecommitTail(&arena);
+            ok = Check(arena.committed == Megabytes(4), "tail decommitted") && ok;
+            float32 *d = PushArray(&arena, float32, Megabytes(1));
+            ok = Check(d == b && d[Megabytes(1) - 1] == 0.f, "recommitted pages are fresh") && ok;
+
+            ArenaSetDecommitAbove(&arena, Megabytes(1));
+            tmp = ArenaTempBegin(&arena);
+            PushArray(&arena, float32, Megabytes(2));
+            ArenaTempEnd(tmp);
+            ok = Check(arena.committed == AlignPow2(arena.pos, ARENA_COMMIT_GRANULE), "temp end decommits over the limit") && ok;
+
+            ArenaFree(&arena);
+            ok = Check(!arena.reserved && !arena.blockCount, "clear releases the range") && ok;
+        }
+    }
+
+    // NOTE(liam): huge pages. whether the system hands them out is up to
+    // its configuration, so only the bookkeeping is checked; the walk and
+    // the smaps report say what was actually obtained.
+    {
+        size_t bytes = Megabytes(64);
+        Arena huge = {0};
+        ArenaSetHugePages(&huge, ARENA_HUGE_PAGE_SIZE);
+        float32 *h = PushArrayAlign(&huge, float32, bytes / sizeof(float32), 64);
+        Arena small = {0};
+        PushArray(&small, uint8, 1);
+        ArenaSetHugePages(&small, 0);
+        float32 *p = PushArrayAlign(&small, float32, bytes / sizeof(float32), 64);
+
+        ok = Check(huge.hugeBlocks + huge.hugeAdvised + huge.hugeRefused == 1 &&
+                   ((memory_index)huge.base & (ARENA_HUGE_PAGE_SIZE - 1)) == 0,
+                   "big block asked for huge pages") && ok;
+
+        float64 plain = PageWalk(p, bytes, 8);
+        float64 large = PageWalk(h, bytes, 8);
+        printf("huge pages: %s, %zu MiB of a %zu MiB push backed; page walk %.2f ms plain, %.2f ms huge\n",
+               huge.hugeBlocks ? "hugetlb" : huge.hugeAdvised ? "advised" : "refused",
+               (size_t)(ArenaHugePageBytes(h) >> 20), bytes >> 20, plain * 1e3, large * 1e3);
+
+        ArenaFree(&huge);
+        ArenaFree(&small);
+
+        // NOTE(liam): a push just under 2 MiB is rounded up to one huge
+        // page, which is exactly a cache class, and still must not be parked.
+        ArenaBlockCache cache;
+        ArenaCacheInit(&cache, 0);
+        Arena cached = {0};
+        ArenaSetBlockCache(&cached, &cache);
+        ArenaSetHugePages(&cached, Megabytes(1));
+        PushArray(&cached, uint8, 100);
+        ArenaTemp tmp = ArenaTempBegin(&cached);
+        PushArray(&cached, uint8, ARENA_HUGE_PAGE_SIZE - Kilobytes(4));
+        bool32 hugePath = cached.size + sizeof(ArenaFooter) == ARENA_HUGE_PAGE_SIZE &&
+                          cached.hugeBlocks + cached.hugeAdvised + cached.hugeRefused == 1;
+        ArenaTempEnd(tmp);
+        ArenaCacheStats stats = ArenaCacheGetStats(&cache);
+        ok = Check(hugePath && stats.cachedBlocks == 0 && stats.releases == 0, "huge blocks bypass the cache") && ok;
+        ArenaFree(&cached);
+        ArenaCacheTrim(&cache, 0);
+
+        Arena reserve = {0};
+        ArenaSetHugePages(&reserve, ARENA_HUGE_PAGE_SIZE);
+        if (ArenaReserve(&reserve, Gigabytes(1)))
+        {
+            PushArray(&reserve, uint8, 100);
+            ok = Check(reserve.committed == ARENA_HUGE_PAGE_SIZE &&
+                       ((memory_index)reserve.base & (ARENA_HUGE_PAGE_SIZE - 1)) == 0,
+                       "huge reservation commits huge pages") && ok;
+            ArenaFree(&reserve);
+        }
+    }
+
+    // NOTE(liam): per-thread scratch arenas.
+    {
+        Arena caller = {0};
+        ArenaTemp a = ArenaGetScratch(&(Arena *){&caller}, 1);
+        ArenaTemp b = ArenaGetScratch(&a.arena, 1);
+        ArenaTemp c = ArenaGetScratch(NULL, 0);
+        ok = Check(a.arena != &caller && b.arena != a.arena && c.arena == a.arena,
+                   "scratch avoids its conflicts") && ok;
+        PushArray(b.arena, uint8, Kilobytes(40));
+        ArenaReleaseScratch(c);
+        ArenaReleaseScratch(b);
+        ArenaReleaseScratch(a);
+        ok = Check(!b.arena->pos && !a.arena->tempCount, "release resets the scope") && ok;
+
+        // NOTE(liam): an empty scratch arena's block goes back to the global
+        // cache at release, and the next scope takes it from there.
+        ArenaCacheStats before = ArenaCacheGetStats(ArenaGlobalCache());
+        for (uint32 i = 0; i < 3; i++)
+        {
+            ArenaTemp t = ArenaGetScratch(NULL, 0);
+            PushArray(t.arena, uint8, Kilobytes(200));
+            ArenaReleaseScratch(t);
+        }
+        ArenaCacheStats after = ArenaCacheGetStats(ArenaGlobalCache());
+        ok = Check(after.hits >= before.hits + 2 && after.unmapped == before.unmapped,
+                   "scratch blocks are cached") && ok;
+
+        ScratchWorker workers[4] = {0};
+        pthread_t threads[4];
+        for (uint32 t = 0; t < 4; t++) pthread_create(threads + t, NULL, ScratchWorkerRun, workers + t);
+        bool32 distinct = true;
+        for (uint32 t = 0; t < 4; t++)
+        {
+            pthread_join(threads[t], NULL);
+            distinct = distinct && workers[t].ok && workers[t].scratch[0] != a.arena &&
+                       workers[t].scratch[0] != workers[t].scratch[1];
+        }
+        ok = Check(distinct, "every thread has its own scratch") && ok;
+    }
+
+    printf("%s\n", ok ? "all arena tests passed." : "arena tests FAILED.");
+    return ok ? 0 : 1;
+}
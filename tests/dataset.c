@@ -0,0 +1,254 @@
+#include "dataset.h"
+#include "test.h"
+#include <string.h>
+
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define DATASET_PATH "build/dataset_test.bin"
+#define MAPPED_PATH  "build/dataset_test.nds"
+
+// NOTE(liam): rewrites the row count and data offset of a mapped dataset.
+static void
+PatchDatasetHeader(const char *path, uint64 rowCount, uint64 dataOffset)
+{
+    FILE *f = fopen(path, "r+b");
+    DatasetFileHeader header;
+    if (!f) return;
+    if (fread(&header, sizeof(header), 1, f) == 1)
+    {
+        header.rowCount = rowCount;
+        header.dataOffset = dataOffset;
+        if (fseek(f, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, f) != 1) perror("fwrite");
+    }
+    fclose(f);
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    bool32 ok = true;
+
+    uint32 records = 1000;
+    uint32 sizes[] = {5, 16, 2};
+    Matrix x = MatrixArenaAlloc(&arena, records, sizes[0]);
+    Matrix y = MatrixArenaAlloc(&arena, records, sizes[2]);
+    MatrixRandomize(&series, x, -1.f, 1.f);
+    MatrixRandomize(&series, y, 0.f, 1.f);
+    ok = Check(DatasetWrite(DATASET_PATH, x, y), "dataset written") && ok;
+
+    DatasetConfig config = {0};
+    config.path = DATASET_PATH;
+    config.inputSize = sizes[0];
+    config.outputSize = sizes[2];
+    config.batchSize = 64;
+    config.ringSize = 3;
+    config.epochs = 2;
+
+    // NOTE(liam): every batch in file order, the last of each epoch short.
+    {
+        DatasetStream ds;
+        bool32 opened = DatasetOpen(&arena, &ds, config);
+        ok = Check(opened && ds.recordCount == records, "dataset opened") && ok;
+
+        uint64 batches = 0;
+        uint64 rows = 0;
+        bool32 same = opened;
+        bool32 ordered = opened;
+        DatasetBatch batch;
+        while (opened && DatasetNext(&ds, &batch))
+        {
+            size_t first = (batch.index % ds.batchesPerEpoch) * config.batchSize;
+            same = same && batch.x.rows == Min(config.batchSize, records - first) &&
+                   memcmp(batch.x.V, x.V + first * x.cols, batch.x.rows * x.cols * sizeof(float32)) == 0 &&
+                   memcmp(batch.y.V, y.V + first * y.cols, batch.y.rows * y.cols * sizeof(float32)) == 0;
+            ordered = ordered && batch.index == batches && batch.epoch == batches / ds.batchesPerEpoch;
+            batches++;
+            rows += batch.x.rows;
+        }
+        ok = Check(same, "streamed batches match the records") && ok;
+        ok = Check(ordered && batches == 2 * 16 && rows == 2 * records, "every epoch streamed in order") && ok;
+        ok = Check(!ds.failed, "no read errors") && ok;
+
+        printf("read %llu bytes in %.2f ms, consumer waited %.2f ms, producer waited %.2f ms\n",
+               (unsigned long long)ds.stats.bytesRead, ds.stats.readSeconds * 1e3,
+               ds.stats.consumerWaitSeconds * 1e3, ds.stats.producerWaitSeconds * 1e3);
+        if (opened) DatasetClose(&ds);
+    }
+
+    // NOTE(liam): closing mid-stream must not hang the producer.
+    {
+        DatasetStream ds;
+        DatasetBatch batch;
+        bool32 opened = DatasetOpen(&arena, &ds, config);
+        bool32 got = opened && DatasetNext(&ds, &batch);
+        if (opened) DatasetClose(&ds);
+        ok = Check(got, "early close") && ok;
+    }
+
+    // NOTE(liam): streamed training is the same sequence of steps as
+    // stepping over the in-memory batches.
+    {
+        NeuralNet a = {0};
+        NeuralNet b = {0};
+        RandomSeries sa = {0};
+        RandomSeries sb = {0};
+        RandomSeed(&sa, 7);
+        RandomSeed(&sb, 7);
+        NeuralNetCompile(&arena, &sa, &a, sizes, ArrayCount(sizes), true);
+        NeuralNetCompile(&arena, &sb, &b, sizes, ArrayCount(sizes), true);
+
+        DatasetStream ds;
+        bool32 opened = DatasetOpen(&arena, &ds, config);
+        uint8 *base = arena.base;
+        size_t pos = arena.pos;
+        if (opened)
+        {
+            NeuralNetLearnStream(&arena, a, &ds, 0.5f);
+            DatasetClose(&ds);
+        }
+        ok = Check(arena.base == base && arena.pos == pos, "streamed training leaves arena alone") && ok;
+
+        NeuralWorkspace ws = {0};
+        NeuralWorkspaceInit(&arena, &ws, b, config.batchSize);
+        for (uint32 e = 0; e < config.epochs; e++)
+        {
+            for (uint32 first = 0; first < records; first += config.batchSize)
+            {
+                uint32 rows = Min(config.batchSize, records - first);
+                NeuralNetStep(&ws, b, MatrixAlloc(rows, x.cols, x.V + (size_t)first * x.cols),
+                              MatrixAlloc(rows, y.cols, y.V + (size_t)first * y.cols), 0.5f);
+            }
+        }
+
+        ok = Check(opened && memcmp(a.params, b.params, a.paramCount * sizeof(float32)) == 0,
+                   "streamed training matches in-memory") && ok;
+    }
+
+    // NOTE(liam): the mapped container, gathered through a permutation.
+    {
+        DatasetFile df;
+        bool32 opened = DatasetFileWrite(MAPPED_PATH, x, y) && DatasetFileOpen(&df, MAPPED_PATH);
+        ok = Check(opened && df.rowCount == records && df.inputSize == sizes[0] &&
+                   df.outputSize == sizes[2] && ((uintptr_t)df.rows & 63) == 0 && df.rowStride % 16 == 0,
+                   "mapped dataset opened") && ok;
+
+        uint32 *order = PushArray(&arena, uint32, records);
+        for (uint32 i = 0; i < records; i++) order[i] = i;
+        RandomShuffle(&series, order, records);
+
+        // NOTE(liam): a permutation hits every row exactly once.
+        uint32 *seen = PushArray(&arena, uint32, records);
+        for (uint32 i = 0; i < records; i++) seen[i] = 0;
+        bool32 permutation = true;
+        for (uint32 i = 0; i < records; i++) permutation = permutation && seen[order[i]]++ == 0;
+        ok = Check(permutation, "shuffle is a permutation") && ok;
+
+        Matrix gx = MatrixArenaAlloc(&arena, records, sizes[0]);
+        Matrix gy = MatrixArenaAlloc(&arena, records, sizes[2]);
+        bool32 same = opened;
+        if (opened)
+        {
+            DatasetFileGather(&df, order, gx, gy);
+            for (uint32 i = 0; same && i < records; i++)
+            {
+                same = memcmp(gx.V + (size_t)i * gx.cols, x.V + (size_t)order[i] * x.cols, x.cols * sizeof(float32)) == 0 &&
+                       memcmp(gy.V + (size_t)i * gy.cols, y.V + (size_t)order[i] * y.cols, y.cols * sizeof(float32)) == 0;
+            }
+        }
+        ok = Check(same, "gathered rows match the records") && ok;
+
+        Matrix vx = {0};
+        Matrix vy = {0};
+        if (opened) DatasetFileViews(&df, &vx, &vy);
+        same = opened && vx.rows == records && vx.stride == df.rowStride && vy.stride == df.rowStride;
+        for (uint32 i = 0; same && i < records; i++)
+        {
+            same = memcmp(&MatrixAT(vx, i, 0), &MatrixAT(x, i, 0), x.cols * sizeof(float32)) == 0 &&
+                   memcmp(&MatrixAT(vy, i, 0), &MatrixAT(y, i, 0), y.cols * sizeof(float32)) == 0;
+        }
+        ok = Check(same, "mapped views match the records") && ok;
+
+        // NOTE(liam): shuffled training from the mapping against shuffled
+        // in-memory training from the same seed: the same permutations
+        // and the same batches, so the same weights.
+        NeuralNet a = {0};
+        NeuralNet b = {0};
+        NeuralNet c = {0};
+        RandomSeries sa = {0};
+        RandomSeries sb = {0};
+        RandomSeries sc = {0};
+        RandomSeed(&sa, 11);
+        RandomSeed(&sb, 11);
+        RandomSeed(&sc, 11);
+        NeuralNetCompile(&arena, &sa, &a, sizes, ArrayCount(sizes), true);
+        NeuralNetCompile(&arena, &sb, &b, sizes, ArrayCount(sizes), true);
+        NeuralNetCompile(&arena, &sc, &c, sizes, ArrayCount(sizes), true);
+        // NOTE(liam): in file order the batches are strided views of the
+        // mapping, and must train exactly like contiguous in-memory rows.
+        NeuralNet d = {0};
+        RandomSeries sd = {0};
+        RandomSeed(&sd, 11);
+        NeuralNetCompile(&arena, &sd, &d, sizes, ArrayCount(sizes), true);
+
+        NeuralLearnConfig learn = {0};
+        learn.epochs = 3;
+        learn.rate = 0.5f;
+        learn.batchSize = 64;
+        learn.threadCount = 1;
+        learn.shuffle = true;
+        uint8 *base = arena.base;
+        size_t pos = arena.pos;
+        if (opened) NeuralNetLearnFile(&arena, &sa, a, &df, learn);
+        ok = Check(arena.base == base && arena.pos == pos, "mapped training leaves arena alone") && ok;
+        NeuralNetLearnWith(&arena, &sb, b, x, y, learn);
+        learn.shuffle = false;
+        NeuralNetLearnWith(&arena, &sc, c, x, y, learn);
+        if (opened) NeuralNetLearnFile(&arena, &sd, d, &df, learn);
+
+        ok = Check(opened && memcmp(a.params, b.params, a.paramCount * sizeof(float32)) == 0,
+                   "mapped shuffled training matches") && ok;
+        ok = Check(opened && memcmp(c.params, d.params, c.paramCount * sizeof(float32)) == 0,
+                   "mapped view training matches") && ok;
+        ok = Check(memcmp(b.params, c.params, b.paramCount * sizeof(float32)) != 0,
+                   "shuffling changes the batches") && ok;
+
+        if (opened) DatasetFileClose(&df);
+
+        // NOTE(liam): 2^58 + 1 rows of 64 bytes wrap to 64 bytes, and a
+        // data offset of 0 would read the header as rows.
+        PatchDatasetHeader(MAPPED_PATH, (1ull << 58) + 1, sizeof(DatasetFileHeader));
+        ok = Check(!DatasetFileOpen(&df, MAPPED_PATH), "wrapping row count rejected") && ok;
+        PatchDatasetHeader(MAPPED_PATH, (uint64)UINT32_MAX + 1, sizeof(DatasetFileHeader));
+        ok = Check(!DatasetFileOpen(&df, MAPPED_PATH), "over 2^32 rows rejected") && ok;
+        PatchDatasetHeader(MAPPED_PATH, 1, 0);
+        ok = Check(!DatasetFileOpen(&df, MAPPED_PATH), "rows inside the header rejected") && ok;
+        PatchDatasetHeader(MAPPED_PATH, records, sizeof(DatasetFileHeader));
+        opened = DatasetFileOpen(&df, MAPPED_PATH);
+        ok = Check(opened && df.rowCount == records, "restored dataset header opens") && ok;
+        if (opened) DatasetFileClose(&df);
+
+        // NOTE(liam): a truncated file must not map.
+        if (truncate(MAPPED_PATH, 64 + 100) == 0)
+        {
+            ok = Check(!DatasetFileOpen(&df, MAPPED_PATH), "truncated mapped dataset rejected") && ok;
+        }
+    }
+
+    config.inputSize = 4;
+    DatasetStream bad;
+    ok = Check(!DatasetOpen(&arena, &bad, config), "partial record rejected") && ok;
+
+    unlink(DATASET_PATH);
+    unlink(MAPPED_PATH);
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all dataset tests passed." : "dataset tests FAILED.");
+    return ok ? 0 : 1;
+}
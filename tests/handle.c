@@ -0,0 +1,169 @@
+#include "handle.h"
+#include "test.h"
+
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define MODEL_PATH "build/handle_test.nn2"
+
+#define READER_COUNT 3
+#define VERSIONS     200
+
+typedef struct handle_reader {
+    NeuralHandle *handle;
+    uint32 index;
+    Matrix X;
+    Matrix Y;
+    bool32 *stop;
+
+    uint64 predicts;
+    uint64 lastVersion;
+    bool32 consistent;
+    float64 maxSeconds;
+} HandleReader;
+
+// NOTE(liam): the published nets have a zero last weight matrix and a
+// linear output, so every output of version v is exactly v. a predict
+// that mixed two snapshots would show two values.
+static void
+SetVersion(NeuralNet nn, float32 v)
+{
+    uint32 last = nn.layerCount - 2;
+    MatrixFill(nn.W[last], 0.f);
+    for (uint32 i = 0; i < nn.B[last].cols; i++) nn.B[last].V[i] = v;
+}
+
+static void *
+ReaderThread(void *ctx)
+{
+    HandleReader *r = ctx;
+    r->consistent = true;
+
+    while (!__atomic_load_n(r->stop, __ATOMIC_ACQUIRE))
+    {
+        float64 start = TimeNow();
+        NeuralSnapshot *snap = NeuralHandleAcquire(r->handle, r->index);
+        if (snap)
+        {
+            NeuralSnapshotPredict(snap, r->index, r->X, r->Y);
+            uint64 version = snap->version;
+            NeuralHandleRelease(r->handle, r->index);
+
+            for (size_t i = 0; i < r->Y.rows * r->Y.cols; i++)
+            {
+                r->consistent = r->consistent && r->Y.V[i] == r->Y.V[0];
+            }
+            // NOTE(liam): versions seen by one reader never go backwards.
+            r->consistent = r->consistent && version >= r->lastVersion;
+            __atomic_store_n(&r->lastVersion, version, __ATOMIC_RELAXED);
+            r->predicts++;
+        }
+        else
+        {
+            NeuralHandleRelease(r->handle, r->index);
+        }
+        r->maxSeconds = Max(r->maxSeconds, TimeNow() - start);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    bool32 ok = true;
+
+    uint32 sizes[] = {8, 64, 32, 4};
+    NeuralNet nn = {0};
+    NeuralNetCompile(&arena, &series, &nn, sizes, ArrayCount(sizes), true);
+    nn.outputActivation = Activation_Linear;
+
+    NeuralHandle handle;
+    NeuralHandleInit(&handle, READER_COUNT, 32);
+
+    bool32 stop = false;
+    HandleReader readers[READER_COUNT] = {0};
+    pthread_t threads[READER_COUNT];
+    for (uint32 i = 0; i < READER_COUNT; i++)
+    {
+        readers[i].handle = &handle;
+        readers[i].index = i;
+        readers[i].X = MatrixArenaAlloc(&arena, 40, sizes[0]);
+        readers[i].Y = MatrixArenaAlloc(&arena, 40, sizes[ArrayCount(sizes) - 1]);
+        readers[i].stop = &stop;
+        MatrixRandomize(&series, readers[i].X, -1.f, 1.f);
+        pthread_create(threads + i, NULL, ReaderThread, readers + i);
+    }
+
+    // NOTE(liam): the writer keeps changing the net it owns and publishes
+    // a copy after every change, like a trainer checkpointing every step.
+    bool32 published = true;
+    for (uint32 v = 1; v <= VERSIONS; v++)
+    {
+        SetVersion(nn, (float32)v);
+        published = published && NeuralHandlePublish(&handle, nn) == v;
+        if (v % 16 == 0) sched_yield();
+    }
+
+    SetVersion(nn, (float32)(VERSIONS + 1));
+    published = published && NeuralNetSaveV2(nn, MODEL_PATH) &&
+                NeuralHandlePublishFile(&handle, MODEL_PATH) == VERSIONS + 1;
+    ok = Check(published, "versions published in order") && ok;
+
+    // NOTE(liam): let every reader run on the final snapshot at least once.
+    // a failed publish never gets there, and the deadline keeps a broken
+    // handle from hanging the run; the readers are stopped either way.
+    bool32 reached = published;
+    float64 deadline = TimeNow() + 10.0;
+    for (uint32 i = 0; reached && i < READER_COUNT; i++)
+    {
+        while (reached && __atomic_load_n(&readers[i].lastVersion, __ATOMIC_RELAXED) != VERSIONS + 1)
+        {
+            reached = TimeNow() < deadline;
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+    ok = Check(reached, "readers reached the final snapshot") && ok;
+
+    bool32 consistent = true;
+    uint64 predicts = 0;
+    float64 maxSeconds = 0.0;
+    for (uint32 i = 0; i < READER_COUNT; i++)
+    {
+        pthread_join(threads[i], NULL);
+        consistent = consistent && readers[i].consistent;
+        predicts += readers[i].predicts;
+        maxSeconds = Max(maxSeconds, readers[i].maxSeconds);
+    }
+    ok = Check(consistent, "readers saw whole snapshots only") && ok;
+
+    // NOTE(liam): with no reader left inside, everything but the current
+    // snapshot must be freed.
+    uint32 waiting = NeuralHandleReclaim(&handle);
+    ok = Check(waiting == 0 && handle.reclaimed == VERSIONS, "retired snapshots reclaimed") && ok;
+
+    NeuralSnapshot *snap = NeuralHandleAcquire(&handle, 0);
+    Matrix X = MatrixArenaAlloc(&arena, 3, sizes[0]);
+    Matrix Y = MatrixArenaAlloc(&arena, 3, sizes[ArrayCount(sizes) - 1]);
+    MatrixFill(X, 0.5f);
+    MatrixFill(Y, 0.f);
+    if (snap) NeuralSnapshotPredict(snap, 0, X, Y);
+    NeuralHandleRelease(&handle, 0);
+    ok = Check(Y.V[0] == (float32)(VERSIONS + 1), "file snapshot serves its weights") && ok;
+
+    printf("%llu predicts across %u publishes, slowest predict %.1f us\n",
+           (unsigned long long)predicts, VERSIONS + 1, maxSeconds * 1e6);
+
+    NeuralHandleDestroy(&handle);
+    unlink(MODEL_PATH);
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all handle tests passed." : "handle tests FAILED.");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "network.h"
+#include "test.h"
+
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define BENCH_ROWS    64
+#define BENCH_REPEATS 100
+
+typedef struct inference_bench {
+    const NeuralModel *model;
+    NeuralContext *contexts;
+    Matrix *X;
+    Matrix *Y;
+    uint32 repeats;
+} InferenceBench;
+
+// NOTE(liam): each thread only touches its own context and its own input
+// and output rows; the model is shared and never written.
+static void
+InferenceTask(void *ctx, uint32 index, uint32 count)
+{
+    InferenceBench *bench = ctx;
+    (void)count;
+    for (uint32 r = 0; r < bench->repeats; r++)
+    {
+        NeuralContextPredict(bench->contexts + index, bench->X[index], bench->Y[index]);
+    }
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    bool32 ok = true;
+
+    uint32 sizes[] = {128, 256, 256, 10};
+    NeuralNet nn = {0};
+    NeuralNetCompile(&arena, &series, &nn, sizes, ArrayCount(sizes), true);
+    nn.activation = Activation_Relu;
+    nn.outputActivation = Activation_Softmax;
+    nn.accuracy = ActivationAccuracy_Approx;
+
+    NeuralModel model;
+    NeuralModelInit(&arena, &model, nn, 0);
+
+    uint32 cpus = ThreadPoolCpuCount();
+    uint32 maxThreads = Max(cpus, 4);
+
+    NeuralContext *contexts = PushArray(&arena, NeuralContext, maxThreads);
+    Matrix *X = PushArray(&arena, Matrix, maxThreads);
+    Matrix *Y = PushArray(&arena, Matrix, maxThreads);
+    for (uint32 t = 0; t < maxThreads; t++)
+    {
+        NeuralContextInit(contexts + t, &model);
+        X[t] = MatrixArenaAlloc(&arena, BENCH_ROWS, sizes[0]);
+        Y[t] = MatrixArenaAlloc(&arena, BENCH_ROWS, sizes[ArrayCount(sizes) - 1]);
+        MatrixRandomize(&series, X[t], -1.f, 1.f);
+    }
+
+    // NOTE(liam): every thread's answer against the regular forward pass.
+    {
+        ThreadPool pool;
+        ThreadPoolInit(&pool, maxThreads);
+        InferenceBench bench = { &model, contexts, X, Y, 1 };
+        ThreadPoolRun(&pool, InferenceTask, &bench);
+        ThreadPoolDestroy(&pool);
+
+        NeuralForward want = {0};
+        NeuralInferenceInitBatch(&arena, &want, nn, BENCH_ROWS);
+        float32 err = 0.f;
+        for (uint32 t = 0; t < maxThreads; t++)
+        {
+            NeuralNetForward(&want, nn, X[t]);
+            Matrix wantOut = want.A[nn.layerCount - 2];
+            for (size_t i = 0; i < Y[t].rows * Y[t].cols; i++)
+            {
+                err = Max(err, fabsf(Y[t].V[i] - wantOut.V[i]));
+            }
+        }
+        ok = Check(err < 1e-5f, "concurrent contexts match forward") && ok;
+    }
+
+    // NOTE(liam): the same per-thread work at each thread count, so ideal
+    // scaling keeps the wall time flat and multiplies predictions/sec.
+    printf("%u cpus online\n", cpus);
+    float64 single = 0.0;
+    for (uint32 threads = 1; threads <= maxThreads;
+         threads = (threads < maxThreads && threads * 2 > maxThreads) ? maxThreads : threads * 2)
+    {
+        ThreadPool pool;
+        ThreadPoolInit(&pool, threads);
+        InferenceBench bench = { &model, contexts, X, Y, BENCH_REPEATS };
+
+        float64 start = TimeNow();
+        ThreadPoolRun(&pool, InferenceTask, &bench);
+        float64 seconds = TimeNow() - start;
+        ThreadPoolDestroy(&pool);
+
+        float64 rate = (float64)threads * BENCH_REPEATS * BENCH_ROWS / seconds;
+        if (threads == 1) single = rate;
+        printf("threads %-3u %12.0f predictions/sec  speedup %.2fx%s\n",
+               threads, rate, rate / single, threads > cpus ? "  (oversubscribed)" : "");
+    }
+
+    for (uint32 t = 0; t < maxThreads; t++) NeuralContextFree(contexts + t);
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all inference tests passed." : "inference tests FAILED.");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,415 @@
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+#include <math.h>
+#include "random.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+// NOTE(liam): the original triple loop, kept as the reference result.
+static void
+MatrixDotNaive(Matrix c, Matrix a, Matrix b)
+{
+    for (size_t i = 0; i < a.rows; i++) {
+        for (size_t j = 0; j < b.cols; j++) {
+            MatrixAT(c, i, j) = 0;
+            for (size_t k = 0; k < b.rows; k++) {
+                MatrixAT(c, i, j) += MatrixAT(a, i, k) * MatrixAT(b, k, j);
+            }
+        }
+    }
+}
+
+static float32
+MatrixMaxRelError(Matrix got, Matrix want)
+{
+    float32 res = 0.f;
+    for (size_t i = 0; i < want.rows; i++) {
+        for (size_t j = 0; j < want.cols; j++) {
+            float32 w = MatrixAT(want, i, j);
+            float32 err = fabsf(MatrixAT(got, i, j) - w) / Max(1.f, fabsf(w));
+            res = Max(res, err);
+        }
+    }
+    return res;
+}
+
+static bool32
+TestDot(Arena *arena, RandomSeries *series, size_t m, size_t k, size_t n)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    Matrix a = MatrixArenaAlloc(arena, m, k);
+    Matrix b = MatrixArenaAlloc(arena, k, n);
+    Matrix want = MatrixArenaAlloc(arena, m, n);
+    Matrix got = MatrixArenaAlloc(arena, m, n);
+
+    MatrixRandomize(series, a, -1.f, 1.f);
+    MatrixRandomize(series, b, -1.f, 1.f);
+    // NOTE(liam): garbage in the output must not leak into the result.
+    MatrixFill(got, NAN);
+
+    MatrixDotNaive(want, a, b);
+    MatrixDot_(got, a, b);
+
+    float32 err = MatrixMaxRelError(got, want);
+    bool32 res = err < 1e-4f;
+    printf("dot %4zux%-4zu . %4zux%-4zu  max rel err %e %s\n",
+           m, k, k, n, err, res ? "ok" : "FAILED");
+
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+// NOTE(liam): c = 2 * op(a) . op(b) + 0.5 * c against explicit transposes.
+static bool32
+TestDotTrans(Arena *arena, RandomSeries *series, size_t m, size_t k, size_t n, bool32 transA, bool32 transB)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    Matrix a = transA ? MatrixArenaAlloc(arena, k, m) : MatrixArenaAlloc(arena, m, k);
+    Matrix b = transB ? MatrixArenaAlloc(arena, n, k) : MatrixArenaAlloc(arena, k, n);
+    Matrix c0 = MatrixArenaAlloc(arena, m, n);
+    Matrix want = MatrixArenaAlloc(arena, m, n);
+    Matrix got = MatrixArenaAlloc(arena, m, n);
+
+    MatrixRandomize(series, a, -1.f, 1.f);
+    MatrixRandomize(series, b, -1.f, 1.f);
+    MatrixRandomize(series, c0, -1.f, 1.f);
+
+    Matrix opA = transA ? MatrixTranspose(arena, a) : a;
+    Matrix opB = transB ? MatrixTranspose(arena, b) : b;
+    MatrixDotNaive(want, opA, opB);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            MatrixAT(want, i, j) = 2.f * MatrixAT(want, i, j) + 0.5f * MatrixAT(c0, i, j);
+        }
+    }
+
+    MatrixCopy_(got, c0);
+    MatrixGemm_(got, a, transA, b, transB, 2.f, 0.5f);
+
+    float32 err = MatrixMaxRelError(got, want);
+    bool32 res = err < 1e-4f;
+    printf("dot%c%c %4zux%-4zu . %4zux%-4zu  max rel err %e %s\n",
+           transA ? 'T' : 'N', transB ? 'T' : 'N',
+           m, k, k, n, err, res ? "ok" : "FAILED");
+
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+static void
+TestHalveRow(float32 *x, size_t n)
+{
+    for (size_t i = 0; i < n; i++) x[i] *= 0.5f;
+}
+
+// NOTE(liam): fused dense layer against dot + bias + separate activation.
+static bool32
+TestDense(Arena *arena, RandomSeries *series, size_t m, size_t k, size_t n)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    Matrix x = MatrixArenaAlloc(arena, m, k);
+    Matrix w = MatrixArenaAlloc(arena, k, n);
+    Row b = RowArenaAlloc(arena, n);
+    Matrix wantZ = MatrixArenaAlloc(arena, m, n);
+    Matrix wantA = MatrixArenaAlloc(arena, m, n);
+    Matrix z = MatrixArenaAlloc(arena, m, n);
+    Matrix a = MatrixArenaAlloc(arena, m, n);
+
+    MatrixRandomize(series, x, -1.f, 1.f);
+    MatrixRandomize(series, w, -1.f, 1.f);
+    MatrixRandomize(series, b, -1.f, 1.f);
+
+    MatrixDotNaive(wantZ, x, w);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            MatrixAT(wantZ, i, j) += RowAT(b, j);
+            MatrixAT(wantA, i, j) = 0.5f * MatrixAT(wantZ, i, j);
+        }
+    }
+
+    MatrixDense_(a, z, x, w, b, TestHalveRow);
+
+    float32 err = Max(MatrixMaxRelError(z, wantZ), MatrixMaxRelError(a, wantA));
+    bool32 res = err < 1e-4f;
+    printf("dense %4zux%-4zu . %4zux%-4zu  max rel err %e %s\n",
+           m, k, k, n, err, res ? "ok" : "FAILED");
+
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+// NOTE(liam): prepacked B with bias + activation against the reference.
+static bool32
+TestDotPacked(Arena *arena, RandomSeries *series, size_t m, size_t k, size_t n, bool32 transB)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    Matrix a = MatrixArenaAlloc(arena, m, k);
+    Matrix b = transB ? MatrixArenaAlloc(arena, n, k) : MatrixArenaAlloc(arena, k, n);
+    Row bias = RowArenaAlloc(arena, n);
+    Matrix want = MatrixArenaAlloc(arena, m, n);
+    Matrix got = MatrixArenaAlloc(arena, m, n);
+
+    MatrixRandomize(series, a, -1.f, 1.f);
+    MatrixRandomize(series, b, -1.f, 1.f);
+    MatrixRandomize(series, bias, -1.f, 1.f);
+    MatrixFill(got, NAN);
+
+    MatrixDotNaive(want, a, transB ? MatrixTranspose(arena, b) : b);
+    for (size_t i = 0; i < m; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            MatrixAT(want, i, j) = 0.5f * (MatrixAT(want, i, j) + RowAT(bias, j));
+        }
+    }
+
+    GemmPackedB pb;
+    float32 *data = PushArrayAlign(arena, float32, GemmPackedBSize(k, n), 64);
+    GemmPackBInto(&pb, data, transB ? Gemm_T : Gemm_N, k, n, b.V, b.cols);
+
+    GemmEpilogue ep = {0};
+    ep.bias = bias.V;
+    ep.act = TestHalveRow;
+    GemmF32Packed(Gemm_N, m, 1.f, a.V, a.cols, &pb, 0.f, got.V, got.cols, &ep);
+
+    float32 err = MatrixMaxRelError(got, want);
+    bool32 res = err < 1e-4f;
+    printf("packed%c %4zux%-4zu . %4zux%-4zu  max rel err %e %s\n",
+           transB ? 'T' : 'N', m, k, k, n, err, res ? "ok" : "FAILED");
+
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+// NOTE(liam): every kernel level against the scalar table, over lengths
+// that exercise the vector body and every tail size.
+static bool32
+TestElementwise(Arena *arena, RandomSeries *series)
+{
+    bool32 res = true;
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    size_t cap = 131;
+    float32 *a = PushArray(arena, float32, cap);
+    float32 *b = PushArray(arena, float32, cap);
+    float32 *want = PushArray(arena, float32, cap);
+    float32 *got = PushArray(arena, float32, cap);
+    for (size_t i = 0; i < cap; i++)
+    {
+        a[i] = RandomBetween(series, -4.f, 4.f);
+        b[i] = RandomBetween(series, -4.f, 4.f);
+    }
+
+    SimdLevel prev = SimdGet()->level;
+    SimdLevel best = SimdDetect();
+    SimdSetLevel(SimdLevel_Scalar);
+    const SimdKernels *ref = SimdGet();
+
+    for (uint32 level = SimdLevel_SSE4; level <= best; level++)
+    {
+        SimdSetLevel((SimdLevel)level);
+        const SimdKernels *k = SimdGet();
+        uint32 failures = 0;
+
+        for (size_t n = 0; n <= cap; n += (n < 40) ? 1 : 13)
+        {
+#define CHECK_OP(call_ref, call_got) \
+            ZeroArray(cap, want); ZeroArray(cap, got); \
+            call_ref; call_got; \
+            for (size_t i = 0; i < cap; i++) \
+            { \
+                if (fabsf(want[i] - got[i]) > 1e-5f * Max(1.f, fabsf(want[i]))) { failures++; break; } \
+            }
+
+            CHECK_OP(ref->add(want, a, b, n), k->add(got, a, b, n))
+            CHECK_OP(ref->sub(want, a, b, n), k->sub(got, a, b, n))
+            CHECK_OP(ref->mul(want, a, b, n), k->mul(got, a, b, n))
+            CHECK_OP(ref->addS(want, a, 1.5f, n), k->addS(got, a, 1.5f, n))
+            CHECK_OP(ref->subS(want, a, 1.5f, n), k->subS(got, a, 1.5f, n))
+            CHECK_OP(ref->mulS(want, a, 1.5f, n), k->mulS(got, a, 1.5f, n))
+            CHECK_OP((ref->copy(want, b, cap), ref->sum(want, a, n)),
+                     (k->copy(got, b, cap), k->sum(got, a, n)))
+            CHECK_OP((ref->copy(want, b, cap), ref->axpy(want, -0.25f, a, n)),
+                     (k->copy(got, b, cap), k->axpy(got, -0.25f, a, n)))
+            CHECK_OP(want[0] = ref->dot(a, b, n), got[0] = k->dot(a, b, n))
+            CHECK_OP(ref->fill(want, 3.f, n), k->fill(got, 3.f, n))
+            CHECK_OP(ref->copy(want, a, n), k->copy(got, a, n))
+#undef CHECK_OP
+        }
+
+        printf("elementwise %-7s %s\n", SimdLevelName((SimdLevel)level), failures ? "FAILED" : "ok");
+        res = res && !failures;
+    }
+
+    SimdSetLevel(prev);
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+// NOTE(liam): views cut out of a padded parent, against the same ops on
+// contiguous copies. nothing outside a view may be written.
+static bool32
+TestViews(Arena *arena, RandomSeries *series, size_t m, size_t k, size_t n)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+    size_t pad = 5;
+
+    Matrix pa = MatrixArenaAlloc(arena, m + pad, k + pad);
+    Matrix pb = MatrixArenaAlloc(arena, k + pad, n + pad);
+    Matrix pc = MatrixArenaAlloc(arena, m + pad, n + pad);
+    Matrix pd = MatrixArenaAlloc(arena, m + pad, n + pad);
+    MatrixRandomize(series, pa, -1.f, 1.f);
+    MatrixRandomize(series, pb, -1.f, 1.f);
+    MatrixRandomize(series, pd, -1.f, 1.f);
+    MatrixFill(pc, 7.f);
+
+    Matrix a = MatrixViewBlock(pa, 2, 3, m, k);
+    Matrix b = MatrixViewBlock(pb, 1, 2, k, n);
+    Matrix c = MatrixViewBlock(pc, 3, 1, m, n);
+    Matrix d = MatrixViewBlock(pd, 2, 2, m, n);
+    Matrix ca = MatrixCopy(arena, a);
+    Matrix cb = MatrixCopy(arena, b);
+    Matrix cd = MatrixCopy(arena, d);
+    Matrix want = MatrixArenaAlloc(arena, m, n);
+
+    bool32 res = a.stride == k + pad && MatrixIsContiguous(a) == (m <= 1) &&
+                 MatrixAT(a, 0, 0) == MatrixAT(pa, 2, 3) &&
+                 MatrixAT(MatrixRow(a, m - 1), 0, k - 1) == MatrixAT(pa, m + 1, k + 2);
+
+    MatrixDot_(want, ca, cb);
+    MatrixDot_(c, a, b);
+    res = res && MatrixMaxRelError(c, want) < 1e-4f;
+
+    Matrix pt = MatrixArenaAlloc(arena, k + pad, n + pad);
+    Matrix t = MatrixViewBlock(pt, pad, 0, k, n);
+    Matrix ct = MatrixArenaAlloc(arena, k, n);
+    MatrixDotTN_(ct, ca, cd);
+    MatrixDotTN_(t, a, d);
+    res = res && MatrixMaxRelError(t, ct) < 1e-4f;
+
+    Row bias = MatrixRow(MatrixViewCols(pd, 1, n + 1), m + 3);
+    Matrix cbias = MatrixCopy(arena, bias);
+    MatrixDense_(want, (Matrix){0}, ca, cb, cbias, TestHalveRow);
+    MatrixDense_(c, (Matrix){0}, a, b, bias, TestHalveRow);
+    res = res && MatrixMaxRelError(c, want) < 1e-4f;
+
+    MatrixAddM_(want, cd, want);
+    MatrixAddM_(c, d, c);
+    res = res && MatrixMaxRelError(c, want) < 1e-5f;
+    MatrixMulM_(want, cd, want);
+    MatrixMulM_(c, d, c);
+    res = res && MatrixMaxRelError(c, want) < 1e-5f;
+    MatrixSubS_(want, want, 0.25f);
+    MatrixSubS_(c, c, 0.25f);
+    res = res && MatrixMaxRelError(c, want) < 1e-5f;
+    MatrixSum(want, cd);
+    MatrixSum(c, d);
+    res = res && MatrixMaxRelError(c, want) < 1e-5f;
+
+    Matrix ta = MatrixTranspose(arena, a);
+    for (size_t i = 0; i < m && res; i++)
+    {
+        for (size_t j = 0; j < k; j++) res = res && MatrixAT(ta, j, i) == MatrixAT(ca, i, j);
+    }
+
+    // NOTE(liam): every cell of pc outside c still holds the fill.
+    for (size_t i = 0; i < pc.rows; i++)
+    {
+        for (size_t j = 0; j < pc.cols; j++)
+        {
+            bool32 inC = i >= 3 && i < 3 + m && j >= 1 && j < 1 + n;
+            if (!inC) res = res && MatrixAT(pc, i, j) == 7.f;
+        }
+    }
+
+    printf("views %4zux%-4zu . %4zux%-4zu  %s\n", m, k, k, n, res ? "ok" : "FAILED");
+
+    ArenaTempEnd(tmp);
+    return res;
+}
+
+static void
+BenchDot(Arena *arena, RandomSeries *series, size_t size)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    Matrix a = MatrixArenaAlloc(arena, size, size);
+    Matrix b = MatrixArenaAlloc(arena, size, size);
+    Matrix c = MatrixArenaAlloc(arena, size, size);
+    MatrixRandomize(series, a, -1.f, 1.f);
+    MatrixRandomize(series, b, -1.f, 1.f);
+
+    float64 start = TimeNow();
+    MatrixDotNaive(c, a, b);
+    float64 naive = TimeNow() - start;
+
+    uint32 reps = 4;
+    start = TimeNow();
+    for (uint32 r = 0; r < reps; r++)
+    {
+        MatrixDot_(c, a, b);
+    }
+    float64 blocked = (TimeNow() - start) / reps;
+
+    float64 flops = 2.0 * size * size * size;
+    printf("dot %zu^3: naive %.3fs (%.2f GFLOP/s), blocked %.4fs (%.2f GFLOP/s), %.1fx\n",
+           size, naive, flops / naive * 1e-9, blocked, flops / blocked * 1e-9,
+           naive / blocked);
+
+    ArenaTempEnd(tmp);
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    bool32 ok = true;
+
+    // NOTE(liam): shapes straddle the small-matrix fallback, tile edges
+    // (MR/NR), and the KC/MC blocking boundaries.
+    size_t shapes[][3] = {
+        {1, 2, 64},
+        {1, 64, 32},
+        {4, 2, 1},
+        {7, 13, 29},
+        {6, 16, 16},
+        {33, 65, 17},
+        {64, 64, 64},
+        {121, 257, 35},
+        {250, 300, 2050},
+        {512, 512, 512},
+    };
+
+    for (uint32 i = 0; i < ArrayCount(shapes); i++)
+    {
+        ok = TestDot(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2]) && ok;
+    }
+
+    for (uint32 i = 0; i < ArrayCount(shapes); i++)
+    {
+        ok = TestDotTrans(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2], true, false) && ok;
+        ok = TestDotTrans(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2], false, true) && ok;
+        ok = TestDotTrans(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2], true, true) && ok;
+        ok = TestDense(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2]) && ok;
+        ok = TestDotPacked(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2], false) && ok;
+        ok = TestDotPacked(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2], true) && ok;
+        ok = TestViews(&arena, &series, shapes[i][0], shapes[i][1], shapes[i][2]) && ok;
+    }
+
+    ok = TestElementwise(&arena, &series) && ok;
+
+    printf("simd level: %s\n", SimdLevelName(SimdGet()->level));
+    BenchDot(&arena, &series, 512);
+
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all matrix tests passed." : "matrix tests FAILED.");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+#include "network.h"
+#include "test.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define MODEL_PATH "build/model_test.nn2"
+
+static bool32
+NeuralNetSame(NeuralNet a, NeuralNet b)
+{
+    bool32 res = a.layerCount == b.layerCount &&
+                 a.activation == b.activation &&
+                 a.outputActivation == b.outputActivation &&
+                 a.accuracy == b.accuracy &&
+                 a.paramCount == b.paramCount;
+    for (uint32 l = 0; res && l < a.layerCount; l++)
+    {
+        res = a.layerSizes[l] == b.layerSizes[l];
+    }
+    return res && memcmp(a.params, b.params, a.paramCount * sizeof(float32)) == 0;
+}
+
+// NOTE(liam): flips one byte of the saved file at offset.
+static void
+CorruptByte(const char *path, off_t offset)
+{
+    int fd = open(path, O_RDWR);
+    uint8 b = 0;
+    if (fd < 0) return;
+    if (pread(fd, &b, 1, offset) == 1)
+    {
+        b ^= 0x5a;
+        if (pwrite(fd, &b, 1, offset) != 1) perror("pwrite");
+    }
+    close(fd);
+}
+
+// NOTE(liam): rewrites the saved header's offsets and size.
+static void
+PatchHeader(const char *path, uint64 tableOffset, uint64 dataOffset, uint64 dataSize)
+{
+    int fd = open(path, O_RDWR);
+    NeuralFileHeader header;
+    if (fd < 0) return;
+    if (pread(fd, &header, sizeof(header), 0) == sizeof(header))
+    {
+        header.tableOffset = tableOffset;
+        header.dataOffset = dataOffset;
+        header.dataSize = dataSize;
+        if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) perror("pwrite");
+    }
+    close(fd);
+}
+
+// NOTE(liam): a 128-byte file whose layer table needs 2^62 floats, which
+// is 0 bytes once multiplied by 4 in 64 bits.
+static bool32
+WriteWrappingModel(const char *path)
+{
+    NeuralFileHeader header = {0};
+    header.magic = NEURAL_FILE_MAGIC;
+    header.version = NEURAL_FILE_VERSION;
+    header.headerSize = sizeof(header);
+    header.layerCount = 2;
+    header.dtype = NeuralDType_F32;
+    header.tableOffset = sizeof(header);
+    header.dataOffset = 128;
+    header.dataSize = 0;
+    header.checksum = NeuralNetChecksum(NULL, 0);
+
+    uint8 file[128] = {0};
+    uint32 sizes[] = {2147483647u, 2147483648u};
+    memcpy(file, &header, sizeof(header));
+    memcpy(file + sizeof(header), sizes, sizeof(sizes));
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool32 res = write(fd, file, sizeof(file)) == sizeof(file);
+    close(fd);
+    return res;
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    bool32 ok = true;
+
+    uint32 sizes[] = {5, 33, 7, 3};
+    NeuralNet nn = {0};
+    NeuralNetCompile(&arena, &series, &nn, sizes, ArrayCount(sizes), true);
+    nn.activation = Activation_Tanh;
+    nn.outputActivation = Activation_Softmax;
+    nn.accuracy = ActivationAccuracy_Approx;
+
+    ok = Check(NeuralNetSaveV2(nn, MODEL_PATH), "save v2") && ok;
+
+    NeuralNet copy = {0};
+    ok = Check(NeuralNetLoadV2(&arena, &copy, MODEL_PATH, NeuralLoad_Copy) && NeuralNetSame(nn, copy),
+               "load copy round trip") && ok;
+
+    NeuralNet mapped = {0};
+    bool32 loaded = NeuralNetLoadV2(&arena, &mapped, MODEL_PATH, NeuralLoad_Map | NeuralLoad_Verify);
+    ok = Check(loaded && NeuralNetSame(nn, mapped), "load mapped round trip") && ok;
+    ok = Check(loaded && ((uintptr_t)mapped.params & 63) == 0, "mapped params 64-byte aligned") && ok;
+
+    if (loaded)
+    {
+        // NOTE(liam): a mapped net runs inference straight off the file.
+        NeuralForward a = {0}, b = {0};
+        Row x = RowArenaAlloc(&arena, sizes[0]);
+        MatrixRandomize(&series, x, -1.f, 1.f);
+        NeuralInferenceInit(&arena, &a, nn);
+        NeuralInferenceInit(&arena, &b, mapped);
+        NeuralNetForward(&a, nn, x);
+        NeuralNetForward(&b, mapped, x);
+        Row ya = a.A[nn.layerCount - 2], yb = b.A[nn.layerCount - 2];
+        ok = Check(memcmp(ya.V, yb.V, ya.cols * sizeof(float32)) == 0, "mapped forward matches") && ok;
+        NeuralNetUnmap(&mapped);
+    }
+
+    // NOTE(liam): worker processes open the file as shared inference
+    // handles and must produce the same outputs as the in-memory net.
+    {
+        uint32 batch = 4;
+        Matrix x = MatrixArenaAlloc(&arena, batch, sizes[0]);
+        MatrixRandomize(&series, x, -1.f, 1.f);
+
+        NeuralForward want = {0};
+        NeuralInferenceInitBatch(&arena, &want, nn, batch);
+        NeuralNetForward(&want, nn, x);
+        Matrix wantOut = want.A[nn.layerCount - 2];
+
+        uint32 workers = 3;
+        int fds[2];
+        bool32 forked = pipe(fds) == 0;
+        for (uint32 w = 0; forked && w < workers; w++)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                Arena workerArena = {0};
+                NeuralInference inf = {0};
+                uint8 same = 0;
+                if (NeuralInferenceOpen(&workerArena, &inf, MODEL_PATH, batch))
+                {
+                    Matrix got = NeuralInferenceRun(&inf, x);
+                    same = memcmp(got.V, wantOut.V, got.rows * got.cols * sizeof(float32)) == 0;
+                    NeuralInferenceClose(&inf);
+                }
+                if (write(fds[1], &same, 1) != 1) same = 0;
+                ArenaFree(&workerArena);
+                _exit(0);
+            }
+            forked = pid > 0;
+        }
+
+        uint32 matched = 0;
+        for (uint32 w = 0; forked && w < workers; w++)
+        {
+            uint8 same = 0;
+            if (read(fds[0], &same, 1) == 1) matched += same;
+            wait(NULL);
+        }
+        if (forked)
+        {
+            close(fds[0]);
+            close(fds[1]);
+        }
+        ok = Check(matched == workers, "shared workers match") && ok;
+
+        NeuralInference inf = {0};
+        if (NeuralInferenceOpen(&arena, &inf, MODEL_PATH, batch))
+        {
+            printf("inference scratch %zu bytes/worker, weights %zu bytes shared\n",
+                   NeuralInferenceScratchBytes(&inf), inf.nn.paramCount * sizeof(float32));
+            NeuralInferenceClose(&inf);
+        }
+    }
+
+    // NOTE(liam): a frozen plan against the regular forward pass, for a
+    // full batch, a partial one and a single row.
+    {
+        uint32 batch = 9;
+        Matrix x = MatrixArenaAlloc(&arena, batch, sizes[0]);
+        MatrixRandomize(&series, x, -1.f, 1.f);
+
+        NeuralForward want = {0};
+        NeuralInferenceInitBatch(&arena, &want, nn, batch);
+        NeuralNetForward(&want, nn, x);
+        Matrix wantOut = want.A[nn.layerCount - 2];
+
+        NeuralPlan plan = {0};
+        bool32 frozen = NeuralNetFreeze(&arena, &plan, nn, batch);
+        float32 err = frozen ? 0.f : 1.f;
+        for (uint32 rows = 1; frozen && rows <= batch; rows += 4)
+        {
+            Matrix got = NeuralPlanPredict(&plan, MatrixAlloc(rows, x.cols, x.V));
+            for (size_t i = 0; i < got.rows * got.cols; i++)
+            {
+                err = Max(err, fabsf(got.V[i] - wantOut.V[i]));
+            }
+        }
+        ok = Check(err < 1e-5f, "frozen plan matches forward") && ok;
+    }
+
+    // NOTE(liam): more rows than one tile, with a ragged last tile, both on
+    // the calling thread and split over a pool.
+    {
+        uint32 rows = 1001;
+        Matrix X = MatrixArenaAlloc(&arena, rows, sizes[0]);
+        MatrixRandomize(&series, X, -1.f, 1.f);
+
+        NeuralForward want = {0};
+        NeuralInferenceInitBatch(&arena, &want, nn, rows);
+        NeuralNetForward(&want, nn, X);
+        Matrix wantOut = want.A[nn.layerCount - 2];
+
+        NeuralPlan plan = {0};
+        NeuralNetFreeze(&arena, &plan, nn, 64);
+
+        Matrix Y = MatrixArenaAlloc(&arena, rows, plan.model.outputSize);
+        NeuralNetPredictBatch(&plan, X, Y);
+        float32 err = 0.f;
+        for (size_t i = 0; i < Y.rows * Y.cols; i++) err = Max(err, fabsf(Y.V[i] - wantOut.V[i]));
+        ok = Check(err < 1e-5f, "predict batch matches forward") && ok;
+
+        ThreadPool pool;
+        ThreadPoolInit(&pool, 3);
+        NeuralPlanAttachPool(&arena, &plan, &pool);
+        MatrixFill(Y, 0.f);
+        NeuralNetPredictBatch(&plan, X, Y);
+        err = 0.f;
+        for (size_t i = 0; i < Y.rows * Y.cols; i++) err = Max(err, fabsf(Y.V[i] - wantOut.V[i]));
+        ok = Check(err < 1e-5f, "threaded predict batch matches forward") && ok;
+        ThreadPoolDestroy(&pool);
+    }
+
+    NeuralNet bad = {0};
+    CorruptByte(MODEL_PATH, sizeof(NeuralFileHeader) + 64);
+    ok = Check(!NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Copy), "corrupt params rejected") && ok;
+    ok = Check(NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Map), "unverified map skips checksum") && ok;
+    NeuralNetUnmap(&bad);
+
+    // NOTE(liam): offsets whose sums wrap past 2^64 back under the file size.
+    NeuralFileHeader saved = {0};
+    {
+        int fd = open(MODEL_PATH, O_RDONLY);
+        if (fd >= 0 && pread(fd, &saved, sizeof(saved), 0) != sizeof(saved)) saved.magic = 0;
+        if (fd >= 0) close(fd);
+    }
+    PatchHeader(MODEL_PATH, UINT64_MAX - 7, saved.dataOffset, saved.dataSize);
+    ok = Check(!NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Map), "wrapping table offset rejected") && ok;
+    PatchHeader(MODEL_PATH, saved.tableOffset, saved.dataOffset, UINT64_MAX - saved.dataOffset + 64);
+    ok = Check(!NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Map), "wrapping data size rejected") && ok;
+    PatchHeader(MODEL_PATH, saved.tableOffset, saved.dataOffset, saved.dataSize);
+    ok = Check(saved.magic && NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Map), "restored header loads") && ok;
+    NeuralNetUnmap(&bad);
+
+    // NOTE(liam): a layer table that only matches dataSize after wrapping.
+    bool32 crafted = WriteWrappingModel(MODEL_PATH);
+    ok = Check(crafted && !NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Map | NeuralLoad_Verify),
+               "wrapping layer table rejected (map)") && ok;
+    ok = Check(crafted && !NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Copy),
+               "wrapping layer table rejected (copy)") && ok;
+
+    CorruptByte(MODEL_PATH, 0);
+    ok = Check(!NeuralNetLoadV2(&arena, &bad, MODEL_PATH, NeuralLoad_Map), "bad magic rejected") && ok;
+
+    unlink(MODEL_PATH);
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all model tests passed." : "model tests FAILED.");
+    return ok ? 0 : 1;
+}
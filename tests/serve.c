@@ -0,0 +1,278 @@
+#include "serve.h"
+#include "test.h"
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#define SOCKET_PATH "build/serve_test.sock"
+
+#define CLIENT_COUNT     6
+#define CLIENT_REQUESTS  50
+#define PIPELINED        40
+
+typedef struct serve_test {
+    Matrix X;     // inputs every request draws its rows from
+    Matrix want;  // reference outputs for X
+    uint32 maxRows;
+} ServeTest;
+
+typedef struct serve_client {
+    ServeTest *test;
+    uint32 index;
+    uint32 sent;
+    float32 err;
+    bool32 ok;
+} ServeClient;
+
+static float32
+RowsError(ServeTest *test, uint32 row, uint32 rows, const float32 *y)
+{
+    float32 res = 0.f;
+    const float32 *want = test->want.V + (size_t)row * test->want.cols;
+    for (size_t i = 0; i < (size_t)rows * test->want.cols; i++)
+    {
+        res = Max(res, fabsf(y[i] - want[i]));
+    }
+    return res;
+}
+
+static void *
+ServerThread(void *ctx)
+{
+    NeuralServerRun(ctx);
+    return NULL;
+}
+
+// NOTE(liam): one request at a time, 1 to 3 rows each, so coalescing only
+// happens across clients.
+static void *
+ClientThread(void *ctx)
+{
+    ServeClient *c = ctx;
+    ServeTest *test = c->test;
+    RandomSeries series = {0};
+    RandomSeed(&series, 77 + c->index);
+
+    NeuralServeHello hello = {0};
+    int fd = NeuralServeConnect(SOCKET_PATH, &hello);
+    c->ok = fd >= 0 && hello.inputSize == test->X.cols && hello.outputSize == test->want.cols;
+
+    float32 y[3 * 16];
+    for (uint32 r = 0; c->ok && r < CLIENT_REQUESTS; r++)
+    {
+        uint32 rows = 1 + (uint32)RandomBetween(&series, 0.f, 2.99f);
+        uint32 row = (c->index * CLIENT_REQUESTS + r) % (test->X.rows - 3);
+        c->ok = NeuralServePredict(fd, hello, r, test->X.V + (size_t)row * test->X.cols, rows, y);
+        if (c->ok)
+        {
+            c->err = Max(c->err, RowsError(test, row, rows, y));
+            c->sent++;
+        }
+    }
+
+    if (fd >= 0) close(fd);
+    return NULL;
+}
+
+static bool32
+SendFrame(int fd, uint32 magic, uint32 rows, uint64 id, const float32 *x, size_t inputSize)
+{
+    NeuralServeFrame frame = {0};
+    frame.magic = magic;
+    frame.rows = rows;
+    frame.id = id;
+    return write(fd, &frame, sizeof(frame)) == sizeof(frame) &&
+           write(fd, x, rows * inputSize * sizeof(float32)) == (ssize_t)(rows * inputSize * sizeof(float32));
+}
+
+static NeuralServeStatus
+RejectStatus(uint32 magic, uint32 rows)
+{
+    NeuralServeHello hello = {0};
+    int fd = NeuralServeConnect(SOCKET_PATH, &hello);
+    NeuralServeFrame reply = {0};
+    reply.status = NeuralServe_Ok;
+
+    if (fd >= 0)
+    {
+        // NOTE(liam): header only; the server must answer before any rows.
+        NeuralServeFrame frame = {0};
+        frame.magic = magic;
+        frame.rows = rows;
+        if (write(fd, &frame, sizeof(frame)) != sizeof(frame) ||
+            read(fd, &reply, sizeof(reply)) != sizeof(reply))
+        {
+            reply.status = NeuralServe_Ok;
+        }
+        close(fd);
+    }
+    return (NeuralServeStatus)reply.status;
+}
+
+// NOTE(liam): pipelines single-row requests and never reads a reply,
+// until the server hangs up. returns how many went out.
+static uint32
+FloodUnread(const float32 *x, size_t inputSize)
+{
+    NeuralServeHello hello = {0};
+    int fd = NeuralServeConnect(SOCKET_PATH, &hello);
+    if (fd < 0) return 0;
+
+    uint32 sent = 0;
+    uint8 request[sizeof(NeuralServeFrame) + 16 * sizeof(float32)];
+    size_t bytes = sizeof(NeuralServeFrame) + inputSize * sizeof(float32);
+    for (; sent < 1000000; sent++)
+    {
+        NeuralServeFrame frame = {0};
+        frame.magic = NEURAL_SERVE_MAGIC;
+        frame.rows = 1;
+        frame.id = sent;
+        memcpy(request, &frame, sizeof(frame));
+        memcpy(request + sizeof(frame), x, inputSize * sizeof(float32));
+        if (send(fd, request, bytes, MSG_NOSIGNAL) != (ssize_t)bytes) break;
+    }
+    close(fd);
+    return sent;
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    bool32 ok = true;
+
+    uint32 sizes[] = {6, 40, 12, 4};
+    NeuralNet nn = {0};
+    NeuralNetCompile(&arena, &series, &nn, sizes, ArrayCount(sizes), true);
+    nn.outputActivation = Activation_Softmax;
+    nn.accuracy = ActivationAccuracy_Approx;
+
+    ServeTest test = {0};
+    test.X = MatrixArenaAlloc(&arena, 512, sizes[0]);
+    MatrixRandomize(&series, test.X, -1.f, 1.f);
+    test.want = MatrixArenaAlloc(&arena, test.X.rows, sizes[ArrayCount(sizes) - 1]);
+
+    NeuralPlan reference = {0};
+    NeuralNetFreeze(&arena, &reference, nn, 64);
+    NeuralNetPredictBatch(&reference, test.X, test.want);
+
+    NeuralPlan plan = {0};
+    NeuralNetFreeze(&arena, &plan, nn, 16);
+
+    NeuralServeConfig config = {0};
+    config.socketPath = SOCKET_PATH;
+    config.maxBatch = 16;
+    config.maxDelayUs = 2000;
+    config.maxClients = 16;
+
+    NeuralServer server;
+    if (!NeuralServerInit(&arena, &server, &plan, config))
+    {
+        printf("serve tests FAILED.\n");
+        return 1;
+    }
+
+    pthread_t serverThread;
+    pthread_create(&serverThread, NULL, ServerThread, &server);
+
+    ServeClient clients[CLIENT_COUNT] = {0};
+    pthread_t threads[CLIENT_COUNT];
+    for (uint32 i = 0; i < CLIENT_COUNT; i++)
+    {
+        clients[i].test = &test;
+        clients[i].index = i;
+        pthread_create(threads + i, NULL, ClientThread, clients + i);
+    }
+
+    uint64 requests = 0;
+    bool32 clientsOk = true;
+    float32 err = 0.f;
+    for (uint32 i = 0; i < CLIENT_COUNT; i++)
+    {
+        pthread_join(threads[i], NULL);
+        clientsOk = clientsOk && clients[i].ok;
+        err = Max(err, clients[i].err);
+        requests += clients[i].sent;
+    }
+    ok = Check(clientsOk && requests == CLIENT_COUNT * CLIENT_REQUESTS, "concurrent clients answered") && ok;
+    ok = Check(err < 1e-5f, "served outputs match predict batch") && ok;
+
+    // NOTE(liam): a burst of single-row requests written back to back must
+    // come back in order, coalesced into batches of at most maxBatch.
+    {
+        NeuralServeHello hello = {0};
+        int fd = NeuralServeConnect(SOCKET_PATH, &hello);
+        bool32 sent = fd >= 0;
+        for (uint32 r = 0; sent && r < PIPELINED; r++)
+        {
+            sent = SendFrame(fd, NEURAL_SERVE_MAGIC, 1, 1000 + r, test.X.V + (size_t)r * test.X.cols, test.X.cols);
+        }
+
+        bool32 inOrder = sent;
+        float32 burstErr = 0.f;
+        for (uint32 r = 0; inOrder && r < PIPELINED; r++)
+        {
+            NeuralServeFrame reply = {0};
+            float32 y[16];
+            inOrder = read(fd, &reply, sizeof(reply)) == sizeof(reply) && reply.id == 1000 + r &&
+                      read(fd, y, hello.outputSize * sizeof(float32)) == (ssize_t)(hello.outputSize * sizeof(float32));
+            burstErr = Max(burstErr, RowsError(&test, r, 1, y));
+        }
+        if (fd >= 0) close(fd);
+        requests += PIPELINED;
+        ok = Check(inOrder && burstErr < 1e-5f, "pipelined burst answered in order") && ok;
+    }
+
+    ok = Check(RejectStatus(0xdeadbeef, 1) == NeuralServe_BadFrame, "bad magic rejected") && ok;
+    ok = Check(RejectStatus(NEURAL_SERVE_MAGIC, 17) == NeuralServe_TooManyRows, "oversized request rejected") && ok;
+
+    NeuralServerStop(&server);
+    pthread_join(serverThread, NULL);
+
+    ok = Check(server.latencyUs.count == requests, "every request has a latency") && ok;
+    ok = Check(server.batches < requests, "requests coalesced into batches") && ok;
+    ok = Check(server.batchRows.max <= config.maxBatch, "batches bounded by max batch") && ok;
+
+    NeuralServerReport(&server, stdout);
+    NeuralServerClose(&server);
+
+    // NOTE(liam): a client that never reads is cut off once its backlog is
+    // full, and the server keeps answering everyone else meanwhile.
+    config.maxBacklog = 4096;
+    if (NeuralServerInit(&arena, &server, &plan, config))
+    {
+        pthread_create(&serverThread, NULL, ServerThread, &server);
+
+        uint32 flooded = FloodUnread(test.X.V, test.X.cols);
+
+        NeuralServeHello hello = {0};
+        int fd = NeuralServeConnect(SOCKET_PATH, &hello);
+        float32 y[16];
+        bool32 served = fd >= 0 && NeuralServePredict(fd, hello, 7, test.X.V, 1, y) &&
+                        RowsError(&test, 0, 1, y) < 1e-5f;
+        if (fd >= 0) close(fd);
+
+        NeuralServerStop(&server);
+        pthread_join(serverThread, NULL);
+        printf("unread client cut off after %u requests\n", flooded);
+        ok = Check(server.dropped == 1 && flooded < 1000000, "unread client cut off") && ok;
+        ok = Check(served, "others served after a cut off") && ok;
+        NeuralServerClose(&server);
+    }
+    else
+    {
+        ok = false;
+    }
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all serve tests passed." : "serve tests FAILED.");
+    return ok ? 0 : 1;
+}
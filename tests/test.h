@@ -0,0 +1,16 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include "def.h"
+
+// NOTE(liam): shared by the tests. prints one aligned result line and
+// passes cond through, so results chain: ok = Check(..., "what") && ok.
+// timings use TimeNow from def.h.
+static bool32
+Check(bool32 cond, const char *what)
+{
+    printf("%-40s %s\n", what, cond ? "ok" : "FAILED");
+    return cond;
+}
+
+#endif //TEST_H
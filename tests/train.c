@@ -0,0 +1,313 @@
+#include "network.h"
+#include <string.h>
+
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+// NOTE(liam): every run starts from the same seed, so two nets trained
+// with the same config should agree exactly.
+static NeuralNet
+TrainOnce(Arena *arena, Matrix x, Matrix y, uint32 *sizes, uint32 layerCount,
+          NeuralLearnConfig config, float64 *seconds)
+{
+    RandomSeries series = {0};
+    RandomSeed(&series, 1020);
+
+    NeuralNet nn = {0};
+    NeuralNetCompile(arena, &series, &nn, sizes, layerCount, true);
+
+    float64 start = TimeNow();
+    NeuralNetLearnWith(arena, &series, nn, x, y, config);
+    *seconds = TimeNow() - start;
+
+    return nn;
+}
+
+static float32
+NeuralNetMaxDiff(NeuralNet a, NeuralNet b)
+{
+    float32 res = 0.f;
+    for (uint32 l = 0; l < a.layerCount - 1; l++)
+    {
+        for (size_t i = 0; i < a.W[l].rows * a.W[l].cols; i++) res = Max(res, fabsf(a.W[l].V[i] - b.W[l].V[i]));
+        for (size_t i = 0; i < a.B[l].cols; i++) res = Max(res, fabsf(a.B[l].V[i] - b.B[l].V[i]));
+    }
+    return res;
+}
+
+static float32
+NeuralNetLoss(Arena *arena, NeuralNet nn, Matrix x, Matrix y)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    NeuralForward nh = {0};
+    NeuralHelperInitBatch(arena, &nh, nn, x.rows);
+    NeuralNetForward(&nh, nn, x);
+
+    Matrix out = nh.A[nn.layerCount - 2];
+    float32 res = 0.f;
+    for (size_t i = 0; i < out.rows * out.cols; i++)
+    {
+        float32 d = out.V[i] - y.V[i];
+        res += d * d;
+    }
+
+    ArenaTempEnd(tmp);
+    return res / (out.rows * out.cols);
+}
+
+// NOTE(liam): no two buffers that are live at the same step may overlap.
+static bool32
+NeuralMemoryPlanValid(NeuralMemoryPlan *plan)
+{
+    bool32 res = true;
+    for (uint32 i = 0; i < plan->bufferCount; i++)
+    {
+        NeuralMemoryBuffer *a = plan->buffers + i;
+        res = res && (a->offset & 63) == 0 && a->offset + a->bytes <= plan->totalBytes;
+        for (uint32 j = i + 1; j < plan->bufferCount; j++)
+        {
+            NeuralMemoryBuffer *b = plan->buffers + j;
+            bool32 together = a->first <= b->last && b->first <= a->last;
+            bool32 overlap = a->offset < b->offset + b->bytes && b->offset < a->offset + a->bytes;
+            res = res && !(together && overlap);
+        }
+    }
+    return res;
+}
+
+static bool32
+TestMemoryPlan(Arena *arena, Matrix x, Matrix y)
+{
+    bool32 ok = true;
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    uint32 sizes[] = {8, 256, 128, 256, 2};
+    uint32 batch = 64;
+    RandomSeries sa = {0};
+    RandomSeries sb = {0};
+    RandomSeed(&sa, 3);
+    RandomSeed(&sb, 3);
+    NeuralNet a = {0};
+    NeuralNet b = {0};
+    NeuralNetCompile(arena, &sa, &a, sizes, ArrayCount(sizes), true);
+    NeuralNetCompile(arena, &sb, &b, sizes, ArrayCount(sizes), true);
+
+    NeuralMemoryPlan train;
+    NeuralMemoryPlan infer;
+    NeuralMemoryPlanBuild(arena, &train, a, batch, NeuralMemory_Train);
+    NeuralMemoryPlanBuild(arena, &infer, a, batch, NeuralMemory_Inference);
+    printf("memory plan %u rows: train %zu of %zu bytes, inference %zu of %zu bytes\n", batch,
+           train.totalBytes, train.naiveBytes, infer.totalBytes, infer.naiveBytes);
+
+    ok = ok && NeuralMemoryPlanValid(&train) && NeuralMemoryPlanValid(&infer);
+    ok = ok && train.totalBytes < train.naiveBytes;
+    // NOTE(liam): inference only ever holds two neighbouring layers, at
+    // most 256 + 128 wide.
+    ok = ok && infer.totalBytes == batch * (256 + 128) * sizeof(float32);
+
+    // NOTE(liam): the same buffers laid end to end, with nothing shared.
+    NeuralMemoryPlan flat = train;
+    flat.buffers = PushArray(arena, NeuralMemoryBuffer, train.bufferCount);
+    flat.totalBytes = 0;
+    for (uint32 i = 0; i < train.bufferCount; i++)
+    {
+        flat.buffers[i] = train.buffers[i];
+        flat.buffers[i].offset = flat.totalBytes;
+        flat.totalBytes += train.buffers[i].bytes;
+    }
+
+    NeuralWorkspace wa = {0};
+    NeuralWorkspace wb = {0};
+    NeuralWorkspaceInitPlanned(arena, &wa, a, &train);
+    NeuralWorkspaceInitPlanned(arena, &wb, b, &flat);
+
+    uint8 *base = arena->base;
+    size_t pos = arena->pos;
+    for (uint32 step = 0; step < 7; step++)
+    {
+        Matrix xb = MatrixViewRows(x, step * batch, step * batch + batch - step);
+        Matrix yb = MatrixViewRows(y, step * batch, step * batch + batch - step);
+        NeuralNetStep(&wa, a, xb, yb, 0.1f);
+        NeuralNetStep(&wb, b, xb, yb, 0.1f);
+    }
+    bool32 same = memcmp(a.params, b.params, a.paramCount * sizeof(float32)) == 0;
+    bool32 quiet = arena->base == base && arena->pos == pos;
+
+    printf("planned workspace matches unshared %s, no step allocation %s\n",
+           same ? "ok" : "FAILED", quiet ? "ok" : "FAILED");
+    ok = ok && same && quiet;
+
+    ArenaTempEnd(tmp);
+    return ok;
+}
+
+// NOTE(liam): a batch with a NaN in one example trains like the same batch
+// without it, whether it runs whole or split in shards.
+static bool32
+TestDroppedRows(Arena *arena, Matrix x, Matrix y)
+{
+    ArenaTemp tmp = ArenaTempBegin(arena);
+
+    uint32 sizes[] = {8, 16, 2};
+    RandomSeries series = {0};
+    RandomSeed(&series, 11);
+    NeuralNet nn = {0};
+    NeuralNetCompile(arena, &series, &nn, sizes, ArrayCount(sizes), true);
+
+    uint32 batch = 16;
+    uint32 bad = 5;
+    Matrix xb = MatrixArenaAlloc(arena, batch, x.cols);
+    Matrix xc = MatrixArenaAlloc(arena, batch - 1, x.cols);
+    Matrix yc = MatrixArenaAlloc(arena, batch - 1, y.cols);
+    MatrixCopy_(xb, MatrixViewRows(x, 0, batch));
+    MatrixCopy_(MatrixViewRows(xc, 0, bad), MatrixViewRows(x, 0, bad));
+    MatrixCopy_(MatrixViewRows(xc, bad, batch - 1), MatrixViewRows(x, bad + 1, batch));
+    MatrixCopy_(MatrixViewRows(yc, 0, bad), MatrixViewRows(y, 0, bad));
+    MatrixCopy_(MatrixViewRows(yc, bad, batch - 1), MatrixViewRows(y, bad + 1, batch));
+    MatrixAT(xb, bad, 3) = NAN;
+    Matrix yb = MatrixViewRows(y, 0, batch);
+
+    NeuralWorkspace whole = {0};
+    NeuralWorkspace clean = {0};
+    NeuralWorkspace shard = {0};
+    NeuralWorkspaceInit(arena, &whole, nn, batch);
+    NeuralWorkspaceInit(arena, &clean, nn, batch);
+    NeuralWorkspaceInit(arena, &shard, nn, batch);
+    NeuralNetBackpropInto(&whole, nn, xb, yb);
+    NeuralNetBackpropInto(&clean, nn, xc, yc);
+
+    float32 *sum = PushArray(arena, float32, whole.grad.flatCount);
+    NeuralNetBackpropInto(&shard, nn, MatrixViewRows(xb, 0, batch / 2), MatrixViewRows(yb, 0, batch / 2));
+    for (size_t i = 0; i < shard.grad.flatCount; i++) sum[i] = shard.grad.flat[i];
+    NeuralNetBackpropInto(&shard, nn, MatrixViewRows(xb, batch / 2, batch), MatrixViewRows(yb, batch / 2, batch));
+    for (size_t i = 0; i < shard.grad.flatCount; i++) sum[i] += shard.grad.flat[i];
+
+    float32 diff = 0.f;
+    float32 split = 0.f;
+    bool32 finite = true;
+    for (size_t i = 0; i < whole.grad.flatCount; i++)
+    {
+        finite = finite && isfinite(whole.grad.flat[i]);
+        diff = Max(diff, fabsf(whole.grad.flat[i] - clean.grad.flat[i]));
+        split = Max(split, fabsf(whole.grad.flat[i] - sum[i]));
+    }
+
+    bool32 ok = whole.droppedRows == 1 && shard.droppedRows == 1 && !clean.droppedRows &&
+                finite && diff < 1e-5f && split < 1e-5f;
+    printf("NaN row dropped: %lu rows, diff %e, sharded diff %e %s\n",
+           (unsigned long)whole.droppedRows, diff, split, ok ? "ok" : "FAILED");
+
+    ArenaTempEnd(tmp);
+    return ok;
+}
+
+int main(void)
+{
+    Arena arena = {0};
+    RandomSeries series = {0};
+    RandomSeed(&series, 7);
+
+    bool32 ok = true;
+
+    // NOTE(liam): a smooth target so the loss never hits exactly zero.
+    uint32 rows = 500;
+    Matrix x = MatrixArenaAlloc(&arena, rows, 8);
+    Matrix y = MatrixArenaAlloc(&arena, rows, 2);
+    MatrixRandomize(&series, x, -1.f, 1.f);
+    for (uint32 i = 0; i < rows; i++)
+    {
+        MatrixAT(y, i, 0) = 0.5f + 0.25f * sinf(MatrixAT(x, i, 0) + MatrixAT(x, i, 1));
+        MatrixAT(y, i, 1) = 0.5f + 0.25f * MatrixAT(x, i, 2) * MatrixAT(x, i, 3);
+    }
+
+    uint32 sizes[] = {8, 64, 64, 2};
+    NeuralLearnConfig config = {0};
+    config.epochs = 5;
+    config.rate = 0.1f;
+    config.batchSize = 64;
+
+    float64 single, threaded, again;
+    config.threadCount = 1;
+    NeuralNet ref = TrainOnce(&arena, x, y, sizes, ArrayCount(sizes), config, &single);
+
+    config.threadCount = 4;
+    NeuralNet a = TrainOnce(&arena, x, y, sizes, ArrayCount(sizes), config, &threaded);
+    NeuralNet b = TrainOnce(&arena, x, y, sizes, ArrayCount(sizes), config, &again);
+
+    float32 repeat = NeuralNetMaxDiff(a, b);
+    float32 drift = NeuralNetMaxDiff(a, ref);
+    printf("4 threads, same seed twice: max diff %e %s\n", repeat, repeat == 0.f ? "ok" : "FAILED");
+    printf("4 threads vs 1 thread: max diff %e %s\n", drift, drift < 1e-4f ? "ok" : "FAILED");
+    ok = ok && repeat == 0.f && drift < 1e-4f;
+
+    // NOTE(liam): hogwild is not reproducible, so only check that it
+    // learns and that the stats account for every example.
+    NeuralThreadStats stats[4] = {0};
+    config.mode = NeuralLearn_Hogwild;
+    config.stats = stats;
+
+    float64 hogwild;
+    config.epochs = 0;
+    float32 initial = NeuralNetLoss(&arena, TrainOnce(&arena, x, y, sizes, ArrayCount(sizes), config, &again), x, y);
+    float32 before = NeuralNetLoss(&arena, ref, x, y);
+
+    config.epochs = 20;
+    NeuralNet h = TrainOnce(&arena, x, y, sizes, ArrayCount(sizes), config, &hogwild);
+    float32 after = NeuralNetLoss(&arena, h, x, y);
+
+    uint64 examples = 0;
+    for (uint32 t = 0; t < ArrayCount(stats); t++)
+    {
+        examples += stats[t].examples;
+        printf("hogwild thread %u: %lu examples, %.0f ex/s, staleness mean %.2f max %lu\n",
+               t, (unsigned long)stats[t].examples, stats[t].examplesPerSecond,
+               stats[t].meanStaleness, (unsigned long)stats[t].maxStaleness);
+    }
+    bool32 learned = after < initial && examples == (uint64)config.epochs * rows;
+    printf("hogwild loss %f -> %f (sync after 5 epochs %f), %lu examples %s\n",
+           initial, after, before, (unsigned long)examples, learned ? "ok" : "FAILED");
+    ok = ok && learned;
+
+    // NOTE(liam): an empty training set is a no-op in every mode.
+    {
+        RandomSeries se = {0};
+        RandomSeed(&se, 5);
+        NeuralNet e = {0};
+        NeuralNetCompile(&arena, &se, &e, sizes, ArrayCount(sizes), true);
+        float32 *before = PushArray(&arena, float32, e.paramCount);
+        memcpy(before, e.params, e.paramCount * sizeof(float32));
+
+        NeuralLearnConfig empty = config;
+        empty.epochs = 2;
+        empty.stats = NULL;
+        empty.shuffle = true;
+        for (uint32 m = 0; m < 3; m++)
+        {
+            empty.mode = m == 2 ? NeuralLearn_Hogwild : NeuralLearn_Sync;
+            empty.threadCount = m ? 4 : 1;
+            NeuralNetLearnWith(&arena, &se, e, MatrixViewRows(x, 0, 0), MatrixViewRows(y, 0, 0), empty);
+        }
+        bool32 untouched = memcmp(before, e.params, e.paramCount * sizeof(float32)) == 0;
+        printf("empty training set %s\n", untouched ? "ok" : "FAILED");
+        ok = ok && untouched;
+    }
+
+    bool32 dropped = TestDroppedRows(&arena, x, y);
+    ok = ok && dropped;
+
+    bool32 planned = TestMemoryPlan(&arena, x, y);
+    printf("memory plan %s\n", planned ? "ok" : "FAILED");
+    ok = ok && planned;
+
+    printf("train %d epochs of %u rows: 1 thread %.3fs, 4 threads %.3fs (%u cpus)\n",
+           5, rows, single, threaded, ThreadPoolCpuCount());
+
+    ArenaFree(&arena);
+
+    printf("%s\n", ok ? "all train tests passed." : "train tests FAILED.");
+    return ok ? 0 : 1;
+}
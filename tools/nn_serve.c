@@ -0,0 +1,119 @@
+#include "serve.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MATRIX_IMPLEMENTATION
+#include "matrix.h"
+
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+static NeuralServer *gServer;
+
+static void
+OnSignal(int sig)
+{
+    (void)sig;
+    if (gServer) NeuralServerStop(gServer);
+}
+
+static void
+Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s model.nn2 socket [options]\n"
+            "  --max-batch N     rows per micro-batch (default 64)\n"
+            "  --max-delay-us N  longest a request waits for a batch to fill (default 500)\n"
+            "  --threads N       threads for each batch (default 1)\n"
+            "  --max-clients N   concurrent connections (default 64)\n"
+            "  --max-backlog N   bytes of unread replies before a client is cut off\n"
+            "                    (default 4 full batches)\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    NeuralServeConfig config = {0};
+    config.socketPath = argv[2];
+    config.maxBatch = 64;
+    config.maxDelayUs = 500;
+    config.maxClients = 64;
+    uint32 threadCount = 1;
+
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        uint32 value = (uint32)strtoul(argv[i + 1], NULL, 10);
+        if      (strcmp(argv[i], "--max-batch") == 0)    config.maxBatch = Max(value, 1);
+        else if (strcmp(argv[i], "--max-delay-us") == 0) config.maxDelayUs = value;
+        else if (strcmp(argv[i], "--threads") == 0)      threadCount = value;
+        else if (strcmp(argv[i], "--max-clients") == 0)  config.maxClients = value;
+        else if (strcmp(argv[i], "--max-backlog") == 0)  config.maxBacklog = value;
+        else
+        {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    Arena arena = {0};
+    NeuralNet nn = {0};
+    if (!NeuralNetLoadV2(&arena, &nn, argv[1], NeuralLoad_Map | NeuralLoad_Verify))
+    {
+        return 1;
+    }
+
+    NeuralPlan plan = {0};
+    ArenaSetHugePages(&arena, ARENA_HUGE_PAGE_SIZE);
+    NeuralNetFreeze(&arena, &plan, nn, config.maxBatch);
+    if (arena.hugeBlocks + arena.hugeAdvised)
+    {
+        fprintf(stderr, "nn-serve: %u weight blocks in huge pages (%u explicit)\n",
+                arena.hugeBlocks + arena.hugeAdvised, arena.hugeBlocks);
+    }
+
+    ThreadPool pool = {0};
+    if (threadCount != 1)
+    {
+        if (ThreadPoolInit(&pool, threadCount ? threadCount : ThreadPoolCpuCount()))
+        {
+            NeuralPlanAttachPool(&arena, &plan, &pool);
+        }
+        else
+        {
+            // NOTE(liam): joins whatever workers did start.
+            fprintf(stderr, "nn-serve: thread pool failed to start, serving on one thread\n");
+            ThreadPoolDestroy(&pool);
+        }
+    }
+
+    NeuralServer server;
+    if (!NeuralServerInit(&arena, &server, &plan, config))
+    {
+        if (plan.pool) ThreadPoolDestroy(&pool);
+        NeuralNetUnmap(&nn);
+        return 1;
+    }
+
+    gServer = &server;
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    fprintf(stderr, "serving %s on %s (%u -> %u, batch %u, delay %u us)\n",
+            argv[1], config.socketPath, plan.model.inputSize, plan.model.outputSize,
+            server.config.maxBatch, config.maxDelayUs);
+    NeuralServerRun(&server);
+    NeuralServerReport(&server, stdout);
+
+    NeuralServerClose(&server);
+    if (plan.pool) ThreadPoolDestroy(&pool);
+    NeuralNetUnmap(&nn);
+    ArenaFree(&arena);
+    return 0;
+}